@@ -130,7 +130,16 @@ public:
         
         srand(static_cast<unsigned>(time(0)));
         for (int i = tempDeck.size() - 1; i > 0; i--) {
-            int j = rand() % (i + 1);
+            // rand() % n favours small numbers, so throw away the values
+            // from the incomplete last block before taking the remainder
+            unsigned long n = i + 1;
+            unsigned long range = (unsigned long)RAND_MAX + 1;
+            unsigned long limit = range - range % n;
+            unsigned long r;
+            do {
+                r = (unsigned long)rand();
+            } while (r >= limit);
+            int j = (int)(r % n);
             swap(tempDeck[i], tempDeck[j]);
         }
         
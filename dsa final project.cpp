@@ -1,5 +1,4 @@
 #include <iostream>
-#include <queue>
 #include <vector>
 #include <algorithm>
 #include <cstdlib>
@@ -7,6 +6,45 @@
 #include <string>
 #include <sstream>
 #include <limits>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <iomanip>
+#include <new>
+#include <type_traits>
+#include <cmath>
+#include <functional>
+#include <fstream>
+#include <memory>
+
+// AVX2 kernels for the batch engine are compiled with a target attribute
+// (no special build flags needed) and only used if the CPU has AVX2
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_AVX2_KERNELS 1
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define HAVE_AVX2_KERNELS 0
+#endif
+
+// Functions that count bits get a second copy using the POPCNT instruction,
+// picked when the program starts (plain builds would call a library routine)
+#if HAVE_AVX2_KERNELS && defined(__ELF__)
+#define POPCNT_CLONES __attribute__((target_clones("popcnt", "default")))
+#else
+#define POPCNT_CLONES
+#endif
+
+#ifdef _WIN32
+// No mmap on Windows: the corpus reader loads the file into memory instead
+#include <malloc.h>   // _aligned_malloc (no aligned_alloc there)
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
@@ -29,610 +67,5942 @@ enum CardType {
     WILD_CARD = 13, WILD_DRAW_FOUR = 14
 };
 
-// Card structure to represent a UNO card
-struct Card {
-    Color color;
-    CardType type;
-    int value;
+// ======================================================
+//                 CARD TEXT LOOKUP TABLES
+// ======================================================
+// A card is stored in one byte: color in the top 3 bits (0-4, 7 = unknown)
+// and type/value in the low 5 bits (0-9 = number, 10-14 = CardType).
+// All text for the 256 possible bytes is built at compile time, so
+// printing a card never builds a string.
+const int CARD_TEXT_LEN = 32;
 
-    // Constructors
-    Card() : color(RED), type(NUMBER), value(0) {}
-    Card(Color c, CardType t, int v) : color(c), type(t), value(v) {}
+struct CardTextTable {
+    char colored[256][CARD_TEXT_LEN];   // ANSI color + "Red 5" + reset (what toString() shows)
+    char plain[256][CARD_TEXT_LEN];     // "Red 5" without color codes
+    const char *colorName[8];           // "Red", "Blue", ...
+    const char *colorNameColored[8];    // Color name wrapped in its ANSI code
+    const char *typeName[32];           // "0".."9", "Skip", "+2", ...
+};
 
-    // Converts number value to string
-    string numberToString(int v) const {
-        stringstream ss; ss << v; return ss.str();
+constexpr const char *ANSI_CODE_BY_COLOR[8] = {
+    "\033[31m", "\033[34m", "\033[32m", "\033[33m", "", "", "", ""
+};
+
+// Appends src to dst[len...] at compile time
+constexpr void appendText(char *dst, int &len, const char *src) {
+    while (*src) dst[len++] = *src++;
+    dst[len] = '\0';
+}
+
+constexpr CardTextTable makeCardTextTable() {
+    CardTextTable t{};
+    const char *colorNames[8] = { "Red", "Blue", "Green", "Yellow", "Wild",
+                                  "Unknown", "Unknown", "Unknown" };
+    const char *coloredNames[8] = { "\033[31mRed\033[0m", "\033[34mBlue\033[0m",
+                                    "\033[32mGreen\033[0m", "\033[33mYellow\033[0m",
+                                    "Wild", "Unknown", "Unknown", "Unknown" };
+    const char *typeNames[15] = { "0", "1", "2", "3", "4", "5", "6", "7", "8", "9",
+                                  "Skip", "Reverse", "+2", "Wild", "+4" };
+
+    for (int c = 0; c < 8; c++) {
+        t.colorName[c] = colorNames[c];
+        t.colorNameColored[c] = coloredNames[c];
     }
+    for (int v = 0; v < 32; v++)
+        t.typeName[v] = v < 15 ? typeNames[v] : "Unknown";
 
-    // Get card color name as text
-    string getColorName() const {
-        switch (color) {
-            case RED:    return "Red";
-            case BLUE:   return "Blue";
-            case GREEN:  return "Green";
-            case YELLOW: return "Yellow";
-            case WILD:   return "Wild";
-            default:     return "Unknown";
+    for (int code = 0; code < 256; code++) {
+        int c = code >> 5, v = code & 31;
+        int plainLen = 0, coloredLen = 0;
+
+        // Wild cards only show their type, the rest show "Color Type"
+        if (v != WILD_CARD && v != WILD_DRAW_FOUR) {
+            appendText(t.plain[code], plainLen, t.colorName[c]);
+            appendText(t.plain[code], plainLen, " ");
         }
+        appendText(t.plain[code], plainLen, t.typeName[v]);
+
+        appendText(t.colored[code], coloredLen, ANSI_CODE_BY_COLOR[c]);
+        appendText(t.colored[code], coloredLen, t.plain[code]);
+        appendText(t.colored[code], coloredLen, "\033[0m");
     }
+    return t;
+}
 
-    // Get card color with ANSI colors for console display
-    string getColorNameColored() const {
-        switch (color) {
-            case RED:    return RED_COLOR + string("Red") + RESET_COLOR;
-            case BLUE:   return BLUE_COLOR + string("Blue") + RESET_COLOR;
-            case GREEN:  return GREEN_COLOR + string("Green") + RESET_COLOR;
-            case YELLOW: return YELLOW_COLOR + string("Yellow") + RESET_COLOR;
-            case WILD:   return "Wild";   // Wild usually has no single color
-            default:     return "Unknown";
-        }
+constexpr CardTextTable CARD_TEXT = makeCardTextTable();
+
+// Card structure to represent a UNO card, packed into a single byte
+struct Card {
+    unsigned char code;   // Color in the top 3 bits, type/value in the low 5 bits
+
+    // Constructors
+    Card() : code(0) {}   // Red 0
+    Card(Color c, CardType t, int v) : code(pack(c, t == NUMBER ? v : (int)t)) {}
+
+    static unsigned char pack(Color c, int typeValue) {
+        int colorBits = (c == UNKNOWN_COLOR) ? 7 : (int)c;
+        return (unsigned char)((colorBits << 5) | typeValue);
     }
 
-    // Get type as string
-    string getTypeName() const {
-        switch (type) {
-            case NUMBER: return numberToString(value);
-            case SKIP: return "Skip";
-            case REVERSE: return "Reverse";
-            case DRAW_TWO: return "+2";
-            case WILD_CARD: return "Wild";
-            case WILD_DRAW_FOUR: return "+4";
-        }
-        return "Unknown";
+    // Field access
+    Color getColor() const {
+        int c = code >> 5;
+        return c == 7 ? UNKNOWN_COLOR : (Color)c;
     }
+    void setColor(Color c) { code = pack(c, getTypeValue()); }
 
-    // Convert card to string representation (with color)
-    string toString() const {
-        string colorCode = "";
-        switch (color) {
-            case RED: colorCode = RED_COLOR; break;
-            case BLUE: colorCode = BLUE_COLOR; break;
-            case GREEN: colorCode = GREEN_COLOR; break;
-            case YELLOW: colorCode = YELLOW_COLOR; break;
-            case WILD: colorCode = ""; break;  // Wild cards default
-        }
-
-        string text = "";
-        if (type == WILD_CARD || type == WILD_DRAW_FOUR)
-            text = getTypeName();
-        else
-            text = getColorName() + " " + getTypeName();
+    // 0-9 for number cards, the CardType value otherwise
+    int getTypeValue() const { return code & 31; }
 
-        return colorCode + text + RESET_COLOR;
+    CardType getType() const {
+        int v = getTypeValue();
+        return v < 10 ? NUMBER : (CardType)v;
     }
-};
 
-// ======================================================
-//                   GAME CONFIG STRUCT
-// ======================================================
-// Holds game configuration like number of players, names, and cards per player
-struct GameConfig {
-    int numPlayers;
-    string playerNames[6];
-    int cardsPerPlayer;
+    // Face value for numbers, 20 for action cards, 50 for wild cards
+    int getValue() const {
+        int v = getTypeValue();
+        return v < 10 ? v : (v >= WILD_CARD ? 50 : 20);
+    }
+
+    // Get card color name as text
+    const char *getColorName() const { return CARD_TEXT.colorName[code >> 5]; }
+
+    // Get card color with ANSI colors for console display
+    const char *getColorNameColored() const { return CARD_TEXT.colorNameColored[code >> 5]; }
+
+    // Get type as text
+    const char *getTypeName() const { return CARD_TEXT.typeName[code & 31]; }
 
-    GameConfig() : numPlayers(0), cardsPerPlayer(7) {}
+    // Card text with ANSI color, straight from the lookup table
+    const char *name() const { return CARD_TEXT.colored[code]; }
+
+    // Convert card to string representation (with color)
+    string toString() const { return name(); }
 };
 
+static_assert(sizeof(Card) == 1, "Card must stay packed into one byte");
+
+const int DECK_SIZE = 108;   // Cards in a full UNO deck
+
 // ======================================================
-//                 MODULE 1: DECK MANAGEMENT
+//                  RANDOM NUMBERS / SHUFFLE
 // ======================================================
-// Handles creating, shuffling, dealing, and drawing cards
-class DeckManagement {
+// xoshiro256** generator with an explicit 64-bit seed. The same seed
+// always gives the same sequence on every compiler and platform, so a
+// game can be replayed exactly from its seed.
+class Rng {
 private:
-    queue<Card> deckQueue;  // The main deck
-    GameConfig config;
-    Card initialTopCard;    // First card on discard pile
+    unsigned long long s[4];
 
-public:
-    // Welcome message
-    void displayWelcomeMessage() {
-       cout << "\033[38;2;255;182;193m============================================\n";
-       cout << "           WELCOME TO UNO GAME!\n";
-       cout << "============================================\033[0m\n\n";
+    static unsigned long long rotl(unsigned long long x, int k) {
+        return (x << k) | (x >> (64 - k));
     }
 
-    // Input number of players, names, and cards per player
-    void inputGameConfiguration() {
-        do {
-            cout << "Enter number of players (2-6): ";
-            cin >> config.numPlayers;
-            if (config.numPlayers < 2 || config.numPlayers > 6)
-                cout << "\033[31m ERROR: Enter between 2 and 6 players.\033[0m\n";
-        } while (config.numPlayers < 2 || config.numPlayers > 6);
-
-        cin.ignore(numeric_limits<streamsize>::max(), '\n');
-        for (int i = 0; i < config.numPlayers; i++) {
-            cout << "Enter name for Player " << i + 1 << ": ";
-            getline(cin, config.playerNames[i]);
-        }
+public:
+    Rng(unsigned long long seedValue = 0) { seed(seedValue); }
 
-        // Input number of cards per player
-        do {
-            cout << "Enter number of cards per player (5-10): ";
-            cin >> config.cardsPerPlayer;
-            if (config.cardsPerPlayer < 5 || config.cardsPerPlayer > 10)
-                cout << "\033[31m ERROR: Enter between 5 and 10 cards numbers.\033[0m\n";
-        } while (config.cardsPerPlayer < 5 || config.cardsPerPlayer > 10);
+    // SplitMix64 step, used to spread one seed over the 256-bit state
+    static constexpr unsigned long long splitMix(unsigned long long &x) {
+        unsigned long long z = (x += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
 
-        cout << "\nConfiguration saved!\n\n";
+    void seed(unsigned long long seedValue) {
+        for (int i = 0; i < 4; i++) s[i] = splitMix(seedValue);
     }
 
-    // Create a full UNO deck
-    void createDeck() {
-        cout << "Creating Deck...\n";
-        vector<Card> tempDeck;
-        Color colors[] = { RED, BLUE, GREEN, YELLOW };
+    // Next 64 random bits
+    unsigned long long next() {
+        unsigned long long result = rotl(s[1] * 5, 7) * 9;
+        unsigned long long t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
 
-        // Add number and action cards for each color
-        for (int c = 0; c < 4; c++) {
-            tempDeck.push_back(Card(colors[c], NUMBER, 0));
-            for (int v = 1; v <= 9; v++) {
-                tempDeck.push_back(Card(colors[c], NUMBER, v));
-                tempDeck.push_back(Card(colors[c], NUMBER, v));
+    // Advance by 2^128 steps (same as 2^128 calls to next()). Generators
+    // jumped 0, 1, 2, ... times never overlap, whatever they are used for.
+    void jump() {
+        static const unsigned long long JUMP[4] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                                   0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+        unsigned long long t[4] = {0, 0, 0, 0};
+        for (int i = 0; i < 4; i++)
+            for (int b = 0; b < 64; b++) {
+                if (JUMP[i] & (1ULL << b))
+                    for (int k = 0; k < 4; k++) t[k] ^= s[k];
+                next();
             }
-            for (int s = 0; s < 2; s++) {
-                tempDeck.push_back(Card(colors[c], SKIP, 20));
-                tempDeck.push_back(Card(colors[c], REVERSE, 20));
-                tempDeck.push_back(Card(colors[c], DRAW_TWO, 20));
+        for (int k = 0; k < 4; k++) s[k] = t[k];
+    }
+
+    // Unbiased number in [0, n) using Lemire's multiply-and-reject method
+    // (almost never needs a division, unlike rand() % n which is biased)
+    unsigned int below(unsigned int n) {
+        unsigned long long m = (next() >> 32) * n;
+        unsigned int low = (unsigned int)m;
+        if (low < n) {
+            unsigned int threshold = (0u - n) % n;
+            while (low < threshold) {
+                m = (next() >> 32) * n;
+                low = (unsigned int)m;
             }
         }
+        return (unsigned int)(m >> 32);
+    }
+};
 
-        // Add wild cards
-        for (int w = 0; w < 4; w++) {
-            tempDeck.push_back(Card(WILD, WILD_CARD, 50));
-            tempDeck.push_back(Card(WILD, WILD_DRAW_FOUR, 50));
-        }
+// ======================================================
+//                   RANDOM STREAMS
+// ======================================================
+// Every game of a run gets its own generators, picked only by the master
+// seed, the game number and what they are for. A game plays the same on
+// any thread, in any order, with any number of threads.
+//   - Each kind of stream starts from the master generator jumped 'kind'
+//     times (2^128 steps apart, so kinds never share numbers).
+//   - Inside a kind, game i is seeded from that start and i (counter
+//     based, so no state is shared or passed between games).
+enum StreamKind {
+    STREAM_SHUFFLE = 0,     // Shuffling the new deck
+    STREAM_RESHUFFLE = 1,   // Reshuffling the discard pile during the game
+    STREAM_BOT = 2,         // Random choices of the bots
+    NUM_STREAM_KINDS = 3
+};
+
+class RngStreams {
+private:
+    unsigned long long masterSeed;
+    unsigned long long base[NUM_STREAM_KINDS];
 
-        // Shuffle deck
-        srand(time(0));
-        random_shuffle(tempDeck.begin(), tempDeck.end());
+public:
+    RngStreams(unsigned long long seed = 0) : masterSeed(seed) {
+        Rng master(seed);
+        for (int k = 0; k < NUM_STREAM_KINDS; k++) {
+            Rng start = master;
+            base[k] = start.next();
+            master.jump();
+        }
+    }
 
-        while (!deckQueue.empty()) deckQueue.pop();
-        for (size_t i = 0; i < tempDeck.size(); ++i) deckQueue.push(tempDeck[i]);
+    unsigned long long seed() const { return masterSeed; }
 
-        cout << "Deck created! Total cards: " << tempDeck.size() << "\n\n";
+    // Seed of stream 'kind' of game 'game'
+    unsigned long long seed(unsigned long long game, StreamKind kind) const {
+        unsigned long long x = base[kind] ^ (game * 0xD1B54A32D192ED03ULL);
+        return Rng::splitMix(x);
     }
 
-    // Deal cards to players
-    void dealCards(Card playerHands[][50], int handSizes[]) {
-        for (int i = 0; i < config.numPlayers; i++)
-            handSizes[i] = 0;
-
-        for (int c = 0; c < config.cardsPerPlayer; c++) {
-            for (int p = 0; p < config.numPlayers; p++) {
-                if (deckQueue.empty()) {
-                    cout << "Deck ran out while dealing!\n";
-                    return;
-                }
-                playerHands[p][handSizes[p]++] = deckQueue.front();
-                deckQueue.pop();
-            }
-        }
+    Rng stream(unsigned long long game, StreamKind kind) const { return Rng(seed(game, kind)); }
+};
 
-        cout << "Cards dealt successfully!\n\n";
+// Fisher-Yates shuffle of n cards in place
+void shuffleCards(Card cards[], int n, Rng &rng) {
+    for (int i = n - 1; i > 0; i--) {
+        int j = (int)rng.below((unsigned int)(i + 1));
+        Card tmp = cards[i];
+        cards[i] = cards[j];
+        cards[j] = tmp;
     }
+}
 
-    // Set initial top card on discard pile
-    void setTopCard() {
-        while (!deckQueue.empty()) {
-            Card c = deckQueue.front();
-            deckQueue.pop();
-            if (c.type == NUMBER) {
-                initialTopCard = c;
-                break;
-            }
-            deckQueue.push(c);
-        }
-        cout << "Initial top card: " << initialTopCard.toString() << "\n\n";
+// ======================================================
+//                  DECK RING BUFFER
+// ======================================================
+// Fixed 108-slot circular queue of 1-byte cards. Drawing, putting a card
+// back under the deck and refilling never allocate memory.
+class CardRing {
+private:
+    Card cards[DECK_SIZE];
+    int head;    // Index of the top card
+    int count;   // Cards currently in the ring
+
+public:
+    CardRing() : head(0), count(0) {}
+
+    bool empty() const { return count == 0; }
+    int size() const { return count; }
+
+    // Replace the contents with n cards (n <= DECK_SIZE), top card first
+    void assign(const Card src[], int n) {
+        memcpy(cards, src, n);
+        head = 0;
+        count = n;
     }
 
-    // Draw a card from the deck
-    Card drawCard() {
-        if (deckQueue.empty()) return Card();
-        Card c = deckQueue.front();
-        deckQueue.pop();
+    // Direct access to the stored cards, valid right after assign()
+    Card *data() { return cards; }
+
+    // Take the top card
+    Card popFront() {
+        Card c = cards[head];
+        head = (head + 1 == DECK_SIZE) ? 0 : head + 1;
+        count--;
         return c;
     }
 
-    bool isDeckEmpty() const { return deckQueue.empty(); }
-    GameConfig getConfig() const { return config; }
-    Card getInitialTopCard() const { return initialTopCard; }
+    // Take up to n cards from the top in one go, returns how many were taken
+    int popFront(Card out[], int n) {
+        if (n > count) n = count;
+        int first = DECK_SIZE - head;          // Cards before the wrap-around
+        if (first > n) first = n;
+        memcpy(out, cards + head, first);
+        memcpy(out + first, cards, n - first);
+        head = (head + n) % DECK_SIZE;
+        count -= n;
+        return n;
+    }
+
+    // Put a card back on top (undoing a draw)
+    void pushFront(Card c) {
+        head = (head == 0) ? DECK_SIZE - 1 : head - 1;
+        cards[head] = c;
+        count++;
+    }
+
+    // Put a card under the deck
+    void pushBack(Card c) {
+        int tail = head + count;
+        if (tail >= DECK_SIZE) tail -= DECK_SIZE;
+        cards[tail] = c;
+        count++;
+    }
 };
 
 // ======================================================
-//               MODULE 2: PLAYER MANAGEMENT
+//                     LAZY DECK
 // ======================================================
-// This class handles all player-related actions in the UNO game
-class PlayerManagement {
-public:
+// Draw pile kept as the number of cards left of each of the 54 kinds
+// (no order at all). A card is only picked when it is drawn, uniformly
+// from the cards left, which has exactly the same distribution as taking
+// the top card of a shuffled pile. Nothing is ever shuffled: a new deck
+// is a copy of the 54-byte starting table, and a reshuffle just adds the
+// discarded cards back. Games usually see only part of the deck.
+//
+// Drawing picks one of the 108 slots of a full deck (slot = kind and
+// copy number) and keeps it if that copy is still there, otherwise tries
+// again. Every card left has exactly one slot, so the result is uniform.
+// With half the deck or less left, it counts through the colors and then
+// the kinds of that color instead.
+//
+// The one place where order matters is the start card: the action cards
+// turned over before it go to the bottom of a shuffled pile. The lazy deck
+// keeps them aside, in that order, and hands them out once the counts
+// run out, the same as reaching the bottom of the pile.
+const int NUM_CARD_KINDS = 54;
+const int MAX_HELD_CARDS = 32;   // Action and wild cards in a deck
 
-    // -------------------------------------------------
-    // Display all cards in a player's hand
-    // -------------------------------------------------
-    void displayPlayerHand(string name, Card hand[], int size) {
-        cout << "\n--- " << name << "'s Hand ---\n";   // Display player name
-        for (int i = 0; i < size; i++)                  // Loop through player's cards
-            cout << i + 1 << ". " << hand[i].toString() << endl;  // Show each card with index
-        cout << endl;
-    }
+// Kind of every card byte (0-53): colored cards by color and value, then
+// wild and +4 whatever color they carry. Bytes that are not cards (no
+// color, type past +4) get kind 0, so any byte gives a valid index.
+struct CardKindTable {
+    unsigned char kind[256];
+};
 
-    // -------------------------------------------------
-    // Check whether the played card is valid or not
-    // -------------------------------------------------
-    bool isValidMove(Card played, Card top) {
+constexpr CardKindTable makeCardKindTable() {
+    CardKindTable t{};
+    for (int code = 0; code < 256; code++) {
+        int color = code >> 5, typeValue = code & 31;
+        if (typeValue == WILD_CARD || typeValue == WILD_DRAW_FOUR)
+            t.kind[code] = (unsigned char)(52 + typeValue - WILD_CARD);
+        else if (color < 4 && typeValue < WILD_CARD)
+            t.kind[code] = (unsigned char)(color * 13 + typeValue);
+    }
+    return t;
+}
 
-        // Wild cards can always be played
-        if (played.type == WILD_CARD || played.type == WILD_DRAW_FOUR) 
-            return true;
+constexpr CardKindTable CARD_KIND_TABLE = makeCardKindTable();
 
-        // If colors match, the move is valid
-        if (played.color == top.color) 
-            return true;
+inline int cardKind(Card c) { return CARD_KIND_TABLE.kind[c.code]; }
 
-        // If both are number cards and values are same
-        if (played.type == NUMBER && top.type == NUMBER && played.value == top.value) 
-            return true;
+// Card of a kind (wild cards without a chosen color)
+inline Card kindCard(int kind) {
+    Card c;
+    c.code = kind >= 52 ? Card::pack(WILD, WILD_CARD + kind - 52)
+                        : Card::pack((Color)(kind / 13), kind % 13);
+    return c;
+}
 
-        // If both are special cards of the same type
-        if (played.type != NUMBER && played.type == top.type) 
-            return true;
+// Copies of each kind in a full deck (one 0, two of 1-9 and of each
+// action card per color, four wild and four +4), and the 108 slots of a
+// full deck as kind * 4 + copy number
+struct KindCounts {
+    unsigned char count[NUM_CARD_KINDS];
+    unsigned char slot[DECK_SIZE];
+};
 
-        // Otherwise, it is an invalid move
-        return false;
-    }
+constexpr KindCounts makeFullDeckCounts() {
+    KindCounts k = {};
+    for (int i = 0; i < 52; i++) k.count[i] = (i % 13 == 0) ? 1 : 2;
+    k.count[52] = k.count[53] = 4;
+    int n = 0;
+    for (int i = 0; i < NUM_CARD_KINDS; i++)
+        for (int c = 0; c < k.count[i]; c++) k.slot[n++] = (unsigned char)(i * 4 + c);
+    return k;
+}
 
-    // -------------------------------------------------
-    // Check whether the player correctly calls UNO
-    // -------------------------------------------------
-    void checkUNO(string name, Card hand[], int &handSize, DeckManagement &deck) {
+constexpr KindCounts FULL_DECK_COUNTS = makeFullDeckCounts();
 
-        // If player has only 1 card left
-        if (handSize == 1) {
+class LazyDeck {
+private:
+    unsigned char count[NUM_CARD_KINDS];
+    unsigned char colorTotal[5];   // Cards left per color, 4 = wild cards
+    unsigned char heldCount;       // Cards put under the deck by drawNumber
+    unsigned char heldTaken;       // ... of which this many are drawn
+    Card held[MAX_HELD_CARDS];
+    int total;                     // Cards in the counts (not held)
 
-            cout << "\nYou have 1 card left! Say 'UNO': ";
-            string call;
-            cin >> call;
+    Card take(int kind) {
+        count[kind]--;
+        colorTotal[kind / 13 < 4 ? kind / 13 : 4]--;
+        total--;
+        return kindCard(kind);
+    }
 
-            // If player fails to say UNO correctly
-            if (call != "UNO" && call != "uno") {
-                cout << "\nYou failed to say UNO! Drawing 2 penalty cards.\n";
+public:
+    LazyDeck() { clear(); }
 
-                // Draw two penalty cards
-                if (!deck.isDeckEmpty()) hand[handSize++] = deck.drawCard();
-                if (!deck.isDeckEmpty()) hand[handSize++] = deck.drawCard();
-            }
-        }
+    void clear() {
+        clearCounts();
+        heldCount = heldTaken = 0;
     }
 
-    // -------------------------------------------------
-    // Handles the complete turn of a single player
-    // -------------------------------------------------
-    bool playerTurn(string name, Card hand[], int &handSize, Card &topCard,
-                    DeckManagement &deck, bool &playedThisTurn)
-    {
-        playedThisTurn = false;   // Assume no card is played initially
+    // Empties the counts but keeps the held cards (undo of a reshuffle,
+    // which only happens once they are all drawn)
+    void clearCounts() {
+        memset(count, 0, sizeof(count));
+        memset(colorTotal, 0, sizeof(colorTotal));
+        total = 0;
+    }
 
-        // Display the player's hand
-        displayPlayerHand(name, hand, handSize);
+    // Full 108-card deck
+    void reset() {
+        memcpy(count, FULL_DECK_COUNTS.count, sizeof(count));
+        for (int c = 0; c < 4; c++) colorTotal[c] = 25;
+        colorTotal[4] = 8;
+        heldCount = heldTaken = 0;
+        total = DECK_SIZE;
+    }
 
-        // Display the top card on the discard pile
-        cout << "Top card: " << topCard.toString() << endl;
+    bool empty() const { return size() == 0; }
+    int size() const { return total + heldCount - heldTaken; }
+    int heldDrawn() const { return heldTaken; }
 
-        // If the top card is a wild card, show chosen color
-        if (topCard.type == WILD_CARD || topCard.type == WILD_DRAW_FOUR)
-            cout << "Current color: " << topCard.getColorNameColored() << endl;
+    // Put a card back (reshuffle, undo). Wild cards lose their color.
+    void add(Card c) {
+        int kind = cardKind(c);
+        count[kind]++;
+        colorTotal[kind / 13 < 4 ? kind / 13 : 4]++;
+        total++;
+    }
 
-        // Ask player to choose a card number or 0 to draw
-        cout << name << ", choose a card to play (0 to draw): ";
-        int choice;
-        cin >> choice;
+    // Undo of a draw made when heldDrawn() was 'heldBefore': a held card
+    // goes back under the deck, any other card into the counts
+    void putBack(Card c, int heldBefore) {
+        if (heldTaken > heldBefore) heldTaken--;
+        else add(c);
+    }
 
-        // -------------------------------------------------
-        // If player chooses to draw a card
-        // -------------------------------------------------
-        if (choice == 0) {
-            if (!deck.isDeckEmpty()) {
-                Card newCard = deck.drawCard();
-                cout << "You drew: " << newCard.toString() << "\n";
-                hand[handSize++] = newCard;   // Add drawn card to hand
-            } else {
-                cout << "Deck is empty  cannot draw.\n";
+    // Random card, like drawing from a shuffled pile
+    Card draw(Rng &rng) {
+        if (total == 0) return held[heldTaken++];
+        if (total * 2 > DECK_SIZE) {
+            while (true) {
+                int slot = FULL_DECK_COUNTS.slot[rng.below(DECK_SIZE)];
+                if ((slot & 3) < count[slot >> 2]) return take(slot >> 2);
             }
-            return false;   // Turn ends without playing
         }
+        int r = (int)rng.below((unsigned int)total), color = 0;
+        while (r >= colorTotal[color]) r -= colorTotal[color++];
+        int kind = color * 13;
+        while (r >= count[kind]) r -= count[kind++];
+        return take(kind);
+    }
 
-        // -------------------------------------------------
-        // Validate the selected card index
-        // -------------------------------------------------
-        int index = choice - 1;
-        if (index < 0 || index >= handSize) {
-            cout << "Invalid choice! You draw 1 card.\n";
-            if (!deck.isDeckEmpty()) {
-                hand[handSize++] = deck.drawCard();
-                cout << "You drew: " << hand[handSize - 1].toString() << "\n";
-            }
-            return false;
+    // The start card, as setTopCard turns it over on a shuffled pile:
+    // cards are drawn until a number shows and the others are held
+    // under the deck. The last card is kept whatever it is.
+    Card drawNumber(Rng &rng) {
+        while (true) {
+            Card c = draw(rng);
+            if (c.getType() == NUMBER || total == 0 || heldCount == MAX_HELD_CARDS) return c;
+            held[heldCount++] = c;
         }
+    }
 
-        // -------------------------------------------------
-        // Validate whether the selected card is playable
-        // -------------------------------------------------
-        if (!isValidMove(hand[index], topCard)) {
-            cout << "Invalid move! You draw 1 card.\n";
-            if (!deck.isDeckEmpty()) {
-                hand[handSize++] = deck.drawCard();
-                cout << "You drew: " << hand[handSize - 1].toString() << "\n";
-            }
-            return false;
-        }
+    // All cards left, in kind order, then the held ones. Leaves the deck empty.
+    int takeAll(Card out[]) {
+        int n = 0;
+        for (int k = 0; k < NUM_CARD_KINDS; k++)
+            for (int i = 0; i < count[k]; i++) out[n++] = kindCard(k);
+        for (int i = heldTaken; i < heldCount; i++) out[n++] = held[i];
+        clear();
+        return n;
+    }
+};
 
-        // -------------------------------------------------
-        // VALID MOVE
-        // -------------------------------------------------
-        cout << name << " played: " << hand[index].toString() << endl;
+// ======================================================
+//                    DISCARD PILE
+// ======================================================
+// Every played card in order, the last one is the top card. When the
+// draw pile runs out, all but the top card go back into the deck.
+class DiscardPile {
+private:
+    Card cards[DECK_SIZE];
+    int count;
 
-        topCard = hand[index];    // Update the top card
-        playedThisTurn = true;    // Mark that a card was played
+public:
+    DiscardPile() : count(0) {}
 
-        // Remove the played card from the player's hand
-        for (int i = index; i < handSize - 1; i++)
-            hand[i] = hand[i + 1];
+    void clear() { count = 0; }
+    int size() const { return count; }
+    void push(Card c) { cards[count++] = c; }
+    Card pop() { return cards[--count]; }
+    Card top() const { return cards[count - 1]; }
 
-        handSize--;   // Reduce hand size
+    // Cards under the top card, oldest first
+    Card *data() { return cards; }
+};
 
-        // -------------------------------------------------
-        // WIN CHECK
-        // -------------------------------------------------
-        if (handSize == 0) {
-            cout << "\n" << name << " has no cards left! " 
-                 << name << " WINS the game!\n";
-            return true;   // Game ends
-        }
+// ======================================================
+//                     PLAYER HAND
+// ======================================================
+const int MAX_PLAYERS = 10;           // 10 players x 10 cards still leaves cards to draw
+const int HAND_CAPACITY = DECK_SIZE;  // A hand can never hold more than the whole deck
 
-        // Check for UNO rule
-        checkUNO(name, hand, handSize, deck);
+// Zobrist keys: one random 64-bit number per (seat, card) in a hand, per
+// top card, per player to move, plus one for each direction/effect flag.
+// handSize[p] is multiplied by the size of a hand whose cards are hidden.
+// Built at compile time like the other lookup tables.
+struct ZobristKeys {
+    unsigned long long hand[MAX_PLAYERS][256];
+    unsigned long long top[256];
+    unsigned long long toMove[MAX_PLAYERS];
+    unsigned long long handSize[MAX_PLAYERS];
+    unsigned long long counterClockwise;
+    unsigned long long effectApplied;
+};
 
-        return false;  // Game continues
-    }
+constexpr ZobristKeys makeZobristKeys() {
+    ZobristKeys k = {};
+    unsigned long long x = 0x5A0B1257ULL;   // Fixed, so hashes are the same in every run
+    for (int p = 0; p < MAX_PLAYERS; p++)
+        for (int c = 0; c < 256; c++) k.hand[p][c] = Rng::splitMix(x);
+    for (int c = 0; c < 256; c++) k.top[c] = Rng::splitMix(x);
+    for (int p = 0; p < MAX_PLAYERS; p++) k.toMove[p] = Rng::splitMix(x);
+    for (int p = 0; p < MAX_PLAYERS; p++) k.handSize[p] = Rng::splitMix(x);
+    k.counterClockwise = Rng::splitMix(x);
+    k.effectApplied = Rng::splitMix(x);
+    return k;
+}
+
+constexpr ZobristKeys ZOBRIST = makeZobristKeys();
+
+// Sets of card kinds (bit k = kind k, see cardKind) for the hand queries below
+struct KindMasks {
+    unsigned long long all;
+    unsigned long long color[4];       // Every kind of one color
+    unsigned long long value[13];      // One value (0-9, skip, reverse, +2) in all four colors
+    unsigned long long wild;           // Wild and +4
+    unsigned long long pointBit[6];    // Kinds whose getValue() has bit j set
 };
 
-// ======================================================
-//                     GAME RULES
-// ======================================================
-// This class handles all the game rules like direction, special cards, etc.
-class GameRules {
-private:
-    bool isClockwise;     // Stores the direction of play (true = clockwise, false = anti-clockwise)
-    bool effectApplied;   // Ensures special card effect is applied only once per turn
+constexpr KindMasks makeKindMasks() {
+    KindMasks m{};
+    for (int k = 0; k < NUM_CARD_KINDS; k++) {
+        unsigned long long bit = 1ULL << k;
+        m.all |= bit;
+        if (k >= 52) m.wild |= bit;
+        else {
+            m.color[k / 13] |= bit;
+            m.value[k % 13] |= bit;
+        }
+        int points = k >= 52 ? 50 : (k % 13 < 10 ? k % 13 : 20);
+        for (int j = 0; j < 6; j++)
+            if ((points >> j) & 1) m.pointBit[j] |= bit;
+    }
+    return m;
+}
 
-public:
-    // Default constructor: game always starts in clockwise direction
-    GameRules() : isClockwise(true), effectApplied(false) {}
+constexpr KindMasks KIND_MASKS = makeKindMasks();
 
-    // This function returns the index of the next player based on direction
-    int nextPlayer(int current, int numPlayers) {
-        // If clockwise ? move forward, else ? move backward safely using modulo
-        return isClockwise ? (current + 1) % numPlayers
-                           : (current - 1 + numPlayers) % numPlayers;
+// A hand as a count per card kind, bit-sliced: bit k of plane[j] is bit j
+// of the count of kind k. All 54 kinds fit in one word per plane, so
+// "any red card?", "how many blue cards?" or "points in hand" are a few
+// ANDs and popcounts instead of a loop over the cards.
+// Two planes would only count up to 3, but a hand can hold all four wild
+// (or +4) cards, hence the third one.
+// The order of the cards is not kept: cards() lists them by kind (red,
+// blue, green, yellow by value, then wild and +4), see Hand::sortByKind.
+struct HandBits {
+    unsigned long long plane[3];
+
+    void clear() { plane[0] = plane[1] = plane[2] = 0; }
+
+    // +1 / -1 on one kind, carried (borrowed) through the planes
+    void add(Card c) {
+        unsigned long long bit = 1ULL << cardKind(c);
+        unsigned long long carry1 = plane[0] & bit, carry2 = plane[1] & carry1;
+        plane[0] ^= bit;
+        plane[1] ^= carry1;
+        plane[2] ^= carry2;
+    }
+    void remove(Card c) {
+        unsigned long long bit = 1ULL << cardKind(c);
+        unsigned long long borrow1 = ~plane[0] & bit, borrow2 = ~plane[1] & borrow1;
+        plane[0] ^= bit;
+        plane[1] ^= borrow1;
+        plane[2] ^= borrow2;
     }
 
-    // This function reverses the direction of play
-    void reverseDirection() { 
-        isClockwise = !isClockwise;  // Toggles direction
+    int countOf(int kind) const {
+        return (int)(((plane[0] >> kind) & 1) | (((plane[1] >> kind) & 1) << 1) |
+                     (((plane[2] >> kind) & 1) << 2));
     }
 
-    // Converts user input string into a Color enum value
-    Color parseColor(string input) {
-        // Convert all letters of input to lowercase
-        for (int i = 0; i < (int)input.size(); i++)
-            input[i] = tolower(input[i]);
+    // Cards of the kinds in 'mask' (inlined into the POPCNT_CLONES callers)
+    __attribute__((always_inline)) int popCount(unsigned long long mask) const {
+        return __builtin_popcountll(plane[0] & mask) + 2 * __builtin_popcountll(plane[1] & mask) +
+               4 * __builtin_popcountll(plane[2] & mask);
+    }
+    POPCNT_CLONES int countIn(unsigned long long mask) const { return popCount(mask); }
+    bool anyIn(unsigned long long mask) const {
+        return ((plane[0] | plane[1] | plane[2]) & mask) != 0;
+    }
 
-        // Match input with valid colors
-        if (input == "red") return RED;
-        if (input == "blue") return BLUE;
-        if (input == "green") return GREEN;
-        if (input == "yellow") return YELLOW;
+    int size() const { return countIn(KIND_MASKS.all); }
+    bool hasColor(Color c) const { return anyIn(KIND_MASKS.color[c]); }
+    int colorCount(Color c) const { return countIn(KIND_MASKS.color[c]); }
 
-        // If input does not match any valid color
-        return UNKNOWN_COLOR;
+    // 0-9, SKIP, REVERSE or DRAW_TWO in any color, or a wild card type
+    bool hasType(int typeValue) const {
+        if (typeValue >= WILD_CARD) return countOf(52 + typeValue - WILD_CARD) > 0;
+        return anyIn(KIND_MASKS.value[typeValue]);
     }
 
-    // Resets the special card effect flag for the next turn
-    void resetEffectFlag() { 
-        effectApplied = false; 
+    // Kinds that may go on 'top' (same rule as cardFits)
+    static unsigned long long fitsMask(Card top) {
+        unsigned long long mask = KIND_MASKS.wild;
+        int color = top.code >> 5, typeValue = top.getTypeValue();
+        if (color < 4) mask |= KIND_MASKS.color[color];
+        if (typeValue < 13) mask |= KIND_MASKS.value[typeValue];
+        return mask;
     }
+    bool canPlayOn(Card top) const { return anyIn(fitsMask(top)); }
 
-    // This function applies special effects of cards like SKIP, DRAW_TWO, WILD, etc.
-    void applySpecialCard(Card &playedCard,      // The card that was just played
-                          int &currentPlayer,    // Current player's index (passed by reference)
+    // Sum of getValue() over the hand
+    POPCNT_CLONES int points() const {
+        int total = 0;
+        for (int j = 0; j < 6; j++) total += popCount(KIND_MASKS.pointBit[j]) << j;
+        return total;
+    }
+
+    // Color held most of (wild cards not counted), red on a tie
+    POPCNT_CLONES Color majorityColor() const {
+        int best = 0, bestCount = popCount(KIND_MASKS.color[RED]);
+        for (int c = 1; c < 4; c++) {
+            int n = popCount(KIND_MASKS.color[c]);
+            if (n > bestCount) {
+                best = c;
+                bestCount = n;
+            }
+        }
+        return (Color)best;
+    }
+
+    // The cards in kind order, returns how many
+    int cards(Card out[]) const {
+        int n = 0;
+        unsigned long long held = plane[0] | plane[1] | plane[2];
+        while (held) {
+            int k = __builtin_ctzll(held);
+            held &= held - 1;
+            for (int i = countOf(k); i > 0; i--) out[n++] = kindCard(k);
+        }
+        return n;
+    }
+};
+
+// One player's cards, stored inline. Since a hand can hold the whole deck,
+// adding never overflows. Removing moves the last card into the gap (O(1)),
+// so the order of the remaining cards can change.
+// The hands of all players live in one array (Hand playerHands[MAX_PLAYERS]),
+// so a game's cards sit in one contiguous block of memory.
+// 'hash' is the sum of the seat's Zobrist keys of all cards in the hand.
+// A sum (not XOR) is used because a hand can hold two identical cards,
+// and it is kept up to date in O(1) by add/removeAt/insertAt, as are the
+// per-kind counts in 'bits'.
+struct Hand {
+    unsigned long long hash;
+    HandBits bits;
+    unsigned char count;
+    unsigned char seat;
+    Card cards[HAND_CAPACITY];
+
+    Hand() : hash(0), count(0), seat(0) { bits.clear(); }
+
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    void clear() {
+        count = 0;
+        hash = 0;
+        bits.clear();
+    }
+
+    // Seat whose keys are used for the hash (set once, on an empty hand)
+    void setSeat(int s) { seat = (unsigned char)s; }
+
+    Card operator[](int i) const { return cards[i]; }
+
+    // Add a card at the end, returns false only if the hand is full
+    bool add(Card c) {
+        if (count >= HAND_CAPACITY) return false;
+        cards[count++] = c;
+        hash += ZOBRIST.hand[seat][c.code];
+        bits.add(c);
+        return true;
+    }
+
+    // Remove and return the card at index i (swap with the last card)
+    Card removeAt(int i) {
+        Card c = cards[i];
+        cards[i] = cards[--count];
+        hash -= ZOBRIST.hand[seat][c.code];
+        bits.remove(c);
+        return c;
+    }
+
+    // Exact opposite of removeAt(i): the card now at i goes back to the end
+    void insertAt(int i, Card c) {
+        cards[count++] = cards[i];
+        cards[i] = c;
+        hash += ZOBRIST.hand[seat][c.code];
+        bits.add(c);
+    }
+
+    // Put the cards in kind order for display (same cards, same hash)
+    void sortByKind() { count = (unsigned char)bits.cards(cards); }
+
+    // Hold a copy of other's cards instead (hashed with this hand's seat)
+    void setCards(const Hand &other) {
+        clear();
+        for (int i = 0; i < other.size(); i++) add(other[i]);
+    }
+};
+
+// ======================================================
+//                 PLAYABLE MOVE TABLE
+// ======================================================
+// For every possible top card byte, a 256-bit set of the card bytes that
+// may be played on it. Built at compile time from the UNO rules, so
+// checking a move is a single table lookup instead of a chain of ifs.
+struct MoveTable {
+    unsigned long long fits[256][4];
+};
+
+constexpr MoveTable makeMoveTable() {
+    MoveTable t{};
+    for (int top = 0; top < 256; top++) {
+        for (int played = 0; played < 256; played++) {
+            int playedType = played & 31;
+            bool ok =
+                // Wild cards can always be played
+                playedType == WILD_CARD || playedType == WILD_DRAW_FOUR ||
+                // If colors match, the move is valid
+                (played >> 5) == (top >> 5) ||
+                // Same number, or special cards of the same type
+                playedType == (top & 31);
+            if (ok) t.fits[top][played >> 6] |= 1ULL << (played & 63);
+        }
+    }
+    return t;
+}
+
+constexpr MoveTable MOVE_TABLE = makeMoveTable();
+
+// Can 'played' go on top of 'top'?
+inline bool cardFits(Card played, Card top) {
+    return (MOVE_TABLE.fits[top.code][played.code >> 6] >> (played.code & 63)) & 1;
+}
+
+// Set of hand slots (bit i = hand card i), enough bits for a full hand
+struct MoveMask {
+    unsigned long long bits[(HAND_CAPACITY + 63) / 64];
+
+    bool any() const { return (bits[0] | bits[1]) != 0; }
+    bool test(int i) const { return (bits[i >> 6] >> (i & 63)) & 1; }
+    int count() const { return __builtin_popcountll(bits[0]) + __builtin_popcountll(bits[1]); }
+
+    // Lowest set slot, or -1 if empty
+    int first() const {
+        if (bits[0]) return __builtin_ctzll(bits[0]);
+        if (bits[1]) return 64 + __builtin_ctzll(bits[1]);
+        return -1;
+    }
+};
+
+// All playable slots of a hand: one table row is fetched for the top card
+// and every card in the hand is a bit test in that row.
+MoveMask legalMoves(const Hand &hand, Card top) {
+    const unsigned long long *row = MOVE_TABLE.fits[top.code];
+    MoveMask m = {{0, 0}};
+    for (int i = 0; i < hand.size(); i++) {
+        unsigned char c = hand.cards[i].code;
+        m.bits[i >> 6] |= ((row[c >> 6] >> (c & 63)) & 1) << (i & 63);
+    }
+    return m;
+}
+
+// ======================================================
+//                   GAME CONFIG STRUCT
+// ======================================================
+// Holds game configuration like number of players, names, and cards per player
+struct GameConfig {
+    int numPlayers;
+    string playerNames[MAX_PLAYERS];
+    int cardsPerPlayer;
+    bool lazyDeck;   // Count-based draw pile instead of a shuffled one
+
+    GameConfig() : numPlayers(0), cardsPerPlayer(7), lazyDeck(false) {}
+};
+
+// --lazy-deck: bot-only games use the count-based deck
+bool lazyDeckMode = false;
+
+// ======================================================
+//                     GAME STATE
+// ======================================================
+// Everything that changes while a game is played, in one flat block of
+// plain data: piles, hands, top card, turn, direction and the random
+// generators of the game. It has no pointers or strings, so
+// copying it (a single memcpy of about 1.8 KB, see below) clones a game in flight,
+// which look-ahead bots need. The modules below are operations on it.
+struct alignas(64) GameState {
+    Hand hands[MAX_PLAYERS];   // All players' cards in one block
+    CardRing drawPile;         // Cards left to draw
+    LazyDeck drawCounts;       // Cards left to draw, if lazyDeck
+    DiscardPile discardPile;   // Played cards, last one on top
+    Rng rng;                   // Shuffles the new deck
+    Rng reshuffleRng;          // Reshuffles the discard pile
+    Card topCard;              // Card to match (wild cards carry the chosen color)
+    int numPlayers;
+    int cardsPerPlayer;
+    int currentPlayer;         // Whose turn it is
+    bool isClockwise;          // Direction of play
+    bool effectApplied;        // Top card's special effect already used
+    bool lazyDeck;             // Draw from drawCounts (with rng) instead of drawPile
+    unsigned char pendingDraw; // Cards a chain of stacked +2 makes someone draw (house rule)
+
+    GameState() : numPlayers(0), cardsPerPlayer(7), currentPlayer(0),
+                  isClockwise(true), effectApplied(false), lazyDeck(false), pendingDraw(0) {
+        for (int p = 0; p < MAX_PLAYERS; p++) hands[p].setSeat(p);
+    }
+
+    // Index of the player after 'current' in the direction of play
+    int nextPlayer(int current) const {
+        return isClockwise ? (current + 1) % numPlayers
+                           : (current - 1 + numPlayers) % numPlayers;
+    }
+
+    // Cards left in the draw pile
+    int drawPileSize() const { return lazyDeck ? drawCounts.size() : drawPile.size(); }
+
+    // Is there a card to draw, counting the discard pile that can be reshuffled?
+    bool canDraw() const { return drawPileSize() > 0 || discardPile.size() > 1; }
+
+    // Move all discarded cards except the top one back into the empty
+    // draw pile and shuffle them there. Both piles use fixed arrays, so
+    // nothing is allocated. Returns how many cards were moved.
+    int reshuffleDiscardPile() {
+        int n = discardPile.size() - 1;
+        if (n <= 0) return 0;
+
+        Card top = discardPile.top();
+        Card *cards = discardPile.data();
+
+        // Wild cards lose the color that was chosen for them
+        for (int i = 0; i < n; i++)
+            if (cards[i].getType() == WILD_CARD || cards[i].getType() == WILD_DRAW_FOUR)
+                cards[i].setColor(WILD);
+
+        if (lazyDeck) {
+            for (int i = 0; i < n; i++) drawCounts.add(cards[i]);
+        } else {
+            drawPile.assign(cards, n);
+            shuffleCards(drawPile.data(), n, reshuffleRng);
+        }
+
+        discardPile.clear();
+        discardPile.push(top);
+        return n;
+    }
+
+    // Take the top card of the draw pile, reshuffling first if it is empty
+    Card drawCard() {
+        if (drawPileSize() == 0) reshuffleDiscardPile();
+        if (drawPileSize() == 0) return Card();
+        return lazyDeck ? drawCounts.draw(rng) : drawPile.popFront();
+    }
+
+    // Take up to n cards without reshuffling, returns how many were taken
+    int takeCards(Card out[], int n) {
+        if (!lazyDeck) return drawPile.popFront(out, n);
+        int got = 0;
+        while (got < n && !drawCounts.empty()) out[got++] = drawCounts.draw(rng);
+        return got;
+    }
+};
+
+static_assert(is_trivially_copyable<GameState>::value,
+              "GameState must be copyable with memcpy");
+
+// Where the bytes go (GCC, x86-64: 1856 in all): 10 hands of 144 (hash,
+// bit counts, 108 cards) = 1440, draw pile ring 116, lazy deck 100,
+// discard pile 112, two Rng 64, top card, counters and flags 20, padded
+// to a multiple of 64 (one cache line). Hands are most of it; a size
+// change here shows in cloneState. The exact padding depends on the
+// compiler, so only the budget of 30 cache lines is checked.
+static_assert(sizeof(GameState) <= 30 * 64, "GameState is over its 30 cache line budget");
+
+// ======================================================
+//                    GAME EVENT LOG
+// ======================================================
+// Compact binary record of games, written as they are played.
+// File: "UNOLOG02" + 8-byte seed, then events. Each event is 2 bytes:
+//   byte 0 = type (high 4 bits) | player (low 4 bits), byte 1 = payload.
+// GAME_START (player field = number of players, payload = cards per player,
+// +128 for the lazy deck)
+// is followed by the two 32-byte generator states of the game (deal
+// shuffle, then reshuffles), which is all the replay tool needs to
+// rebuild the same deck.
+// Bytes are collected in a fixed buffer and written in large blocks.
+enum EventType {
+    EV_GAME_START = 0,
+    EV_PLAY = 1,        // payload = card byte as it was in the hand
+    EV_DRAW = 2,        // payload = card drawn instead of playing
+    EV_PENALTY = 3,     // payload = card drawn as a penalty (UNO, +2, +4)
+    EV_COLOR = 4,       // payload = color chosen for a wild card
+    EV_DIRECTION = 5,   // payload = 1 clockwise, 0 counter-clockwise
+    EV_GAME_END = 6     // player = winner, 15 = draw
+};
+
+const char EVENT_LOG_MAGIC[8] = {'U', 'N', 'O', 'L', 'O', 'G', '0', '2'};
+const int NO_WINNER = 15;
+
+class EventLog {
+public:
+    static const int BUFFER_BYTES = 1 << 16;
+
+private:
+    ofstream out;
+    char buffer[BUFFER_BYTES];
+    int used;
+    long long written;   // Bytes already handed to the file
+    long long dropped;   // Bytes flushed while no file was open (lost)
+
+    void put(int type, int player, int payload) {
+        if (used + 2 > (int)sizeof(buffer)) flush();
+        buffer[used] = (char)((type << 4) | (player & 15));
+        buffer[used + 1] = (char)payload;
+        used += 2;
+    }
+
+public:
+    EventLog() : used(0), written(0), dropped(0) {}
+    ~EventLog() { close(); }
+
+    // Creates the file and writes the header. False if it cannot be opened.
+    bool open(const string &path, unsigned long long seed) {
+        out.open(path.c_str(), ios::binary | ios::trunc);
+        if (!out) return false;
+        out.write(EVENT_LOG_MAGIC, 8);
+        out.write((const char *)&seed, 8);
+        return true;
+    }
+
+    void flush();
+
+    void close() {
+        flush();
+        if (out.is_open()) out.close();
+    }
+
+    // Bytes logged so far (without the file header)
+    long long bytes() const { return written + used; }
+
+    // Bytes lost because the buffer filled up with no file to write to
+    long long droppedBytes() const { return dropped; }
+
+    // Events not written to the file yet (a log that is never opened just
+    // collects them here, which is how the corpus builder reads a game)
+    const char *pending() const { return buffer; }
+    int pendingBytes() const { return used; }
+    void discardPending() {
+        written += used;
+        used = 0;
+    }
+
+    void gameStart(int numPlayers, int cardsPerPlayer, bool lazyDeck, const Rng &rng,
+                   const Rng &reshuffleRng) {
+        put(EV_GAME_START, numPlayers, cardsPerPlayer | (lazyDeck ? 128 : 0));
+        if (used + 2 * (int)sizeof(Rng) > (int)sizeof(buffer)) flush();
+        memcpy(buffer + used, &rng, sizeof(Rng));
+        memcpy(buffer + used + sizeof(Rng), &reshuffleRng, sizeof(Rng));
+        used += 2 * sizeof(Rng);
+    }
+    void play(int player, Card c)    { put(EV_PLAY, player, c.code); }
+    void draw(int player, Card c)    { put(EV_DRAW, player, c.code); }
+    void penalty(int player, Card c) { put(EV_PENALTY, player, c.code); }
+    void color(int player, Color c)  { put(EV_COLOR, player, c); }
+    void direction(int player, bool clockwise) { put(EV_DIRECTION, player, clockwise); }
+    void gameEnd(int winner) { put(EV_GAME_END, winner < 0 ? NO_WINNER : winner, 0); }
+};
+
+// Writes the buffered events to the file
+void EventLog::flush() {
+    if (out.is_open()) out.write(buffer, used);
+    else dropped += used;
+    written += used;
+    used = 0;
+}
+
+// ======================================================
+//                    CARD TRACKER
+// ======================================================
+// What each player has not seen yet: the full deck minus their own hand
+// and minus every card played face up. Kept as counts (per kind, per
+// color and per value), updated by the modules on every deal, play, draw,
+// penalty and reshuffle, so questions like "how likely is the next draw
+// to fit on this card" are a few additions, with no scan of any pile.
+// From one player's view the draw pile is a random part of the cards they
+// have not seen, so each unseen card is equally likely to come next.
+
+// One player's unseen cards
+struct UnseenCards {
+    unsigned char kind[NUM_CARD_KINDS];   // By cardKind()
+    unsigned char color[4];               // Colored cards by color
+    unsigned char value[13];              // Colored cards by value (0-9, skip, reverse, +2)
+    int total;
+
+    // Nothing seen yet: the full deck
+    void reset() {
+        memcpy(kind, FULL_DECK_COUNTS.count, sizeof(kind));
+        for (int c = 0; c < 4; c++) color[c] = 25;
+        value[0] = 4;
+        for (int v = 1; v < 13; v++) value[v] = 8;
+        total = DECK_SIZE;
+    }
+
+    void remove(Card c) { change(c, -1); }
+    void add(Card c) { change(c, 1); }
+
+    void change(Card c, int delta) {
+        int k = cardKind(c);
+        kind[k] += delta;
+        if (k < 52) {
+            color[k / 13] += delta;
+            value[k % 13] += delta;
+        }
+        total += delta;
+    }
+
+    int count(int k) const { return kind[k]; }
+
+    // Unseen cards that can be played on 'top' (isValidMove rule)
+    int playableOn(Card top) const {
+        int n = kind[52] + kind[53];   // Wild cards always fit
+        int c = top.code >> 5, v = top.getTypeValue();   // Color bits: 4 = wild, 7 = none
+        if (c < 4) n += color[c];
+        if (c < 4 && v < WILD_CARD) n += value[v] - kind[c * 13 + v];   // Same value, other color
+        else if (c >= 4 && v < WILD_CARD) n += value[v];
+        return n;
+    }
+
+    // Chance that the next card drawn can be played on 'top'
+    double nextDrawPlayable(Card top) const {
+        return total > 0 ? (double)playableOn(top) / total : 0.0;
+    }
+
+    // Expected number of cards of kind k still in the draw pile
+    double expectedInDrawPile(int k, int drawPileSize) const {
+        return total > 0 ? (double)kind[k] * drawPileSize / total : 0.0;
+    }
+
+    // Expected number of +4 cards still to come from the draw pile
+    double expectedDrawFours(int drawPileSize) const {
+        return expectedInDrawPile(52 + WILD_DRAW_FOUR - WILD_CARD, drawPileSize);
+    }
+};
+
+class CardTracker {
+private:
+    UnseenCards seats[MAX_PLAYERS];
+    int numPlayers;
+
+    // knownCards[p][q][k]: cards of kind k that p saw go into q's hand
+    // (7-0 house rule) and has not seen played since. They are not in p's
+    // unseen cards, so those stay exactly what the draw can bring.
+    unsigned char knownCards[MAX_PLAYERS][MAX_PLAYERS][NUM_CARD_KINDS];
+    bool anyKnown;   // Only passed hands fill knownCards
+
+public:
+    CardTracker() : numPlayers(0), anyKnown(false) { memset(knownCards, 0, sizeof(knownCards)); }
+
+    const UnseenCards &unseenBy(int seat) const { return seats[seat]; }
+
+    // Cards of kind k that 'seat' knows 'holder' has
+    int known(int seat, int holder, int k) const { return knownCards[seat][holder][k]; }
+
+    // After the deal and the first top card
+    void newGame(const GameState &s) {
+        numPlayers = s.numPlayers;
+        if (anyKnown) {
+            memset(knownCards, 0, sizeof(knownCards));
+            anyKnown = false;
+        }
+        for (int p = 0; p < numPlayers; p++) {
+            seats[p].reset();
+            for (int i = 0; i < s.hands[p].size(); i++) seats[p].remove(s.hands[p][i]);
+            if (s.discardPile.size() > 0) seats[p].remove(s.discardPile.top());
+        }
+    }
+
+    // A card played face up: everyone else sees it (or already knew it)
+    void played(int seat, Card c) {
+        for (int p = 0; p < numPlayers; p++) {
+            if (p == seat) continue;
+            unsigned char *k = anyKnown ? &knownCards[p][seat][cardKind(c)] : NULL;
+            if (k && *k > 0) (*k)--;
+            else seats[p].remove(c);
+        }
+    }
+
+    // A drawn card (normal or penalty): only the one drawing sees it
+    void drew(int seat, Card c) { seats[seat].remove(c); }
+
+    // Hands passed on (7-0 house rule): old[q] now belongs to dest[q].
+    // What anyone knew about a hand moves with it, a player sees the hand
+    // they receive, and knows who now holds the one they gave away.
+    void handsPassed(const int dest[], const Hand old[]) {
+        anyKnown = true;
+        for (int p = 0; p < numPlayers; p++) {
+            unsigned char moved[MAX_PLAYERS][NUM_CARD_KINDS];
+            for (int q = 0; q < numPlayers; q++) memcpy(moved[dest[q]], knownCards[p][q], NUM_CARD_KINDS);
+            for (int q = 0; q < numPlayers; q++) memcpy(knownCards[p][q], moved[q], NUM_CARD_KINDS);
+            if (dest[p] == p) continue;   // Kept their own hand
+
+            int from = 0;
+            while (dest[from] != p) from++;
+            for (int i = 0; i < old[from].size(); i++) {
+                unsigned char &k = knownCards[p][p][cardKind(old[from][i])];
+                if (k > 0) k--;
+                else seats[p].remove(old[from][i]);
+            }
+            for (int i = 0; i < old[p].size(); i++) knownCards[p][dest[p]][cardKind(old[p][i])]++;
+        }
+    }
+
+    // Discarded cards shuffled back into the draw pile are hidden again
+    void reshuffled(const Card cards[], int n) {
+        for (int p = 0; p < numPlayers; p++)
+            for (int i = 0; i < n; i++) seats[p].add(cards[i]);
+    }
+};
+
+// ======================================================
+//                 MODULE 1: DECK MANAGEMENT
+// ======================================================
+// Handles creating, shuffling, dealing, and drawing cards.
+// The piles themselves live in the GameState it works on.
+class DeckManagement {
+private:
+    GameState &state;
+    Card fullDeck[DECK_SIZE]; // Unshuffled deck, copied in by createDeck()
+    GameConfig config;
+    bool quiet;             // true = no console output (headless simulation)
+    EventLog *events;       // NULL = no event log
+    CardTracker *tracker;   // NULL = nobody counts cards
+
+public:
+    DeckManagement(GameState &s) : state(s), quiet(false), events(NULL), tracker(NULL) {
+        buildFullDeck();
+        seedShuffle((unsigned long long)time(0));
+    }
+
+    // Seed the shuffle generators. The same seed always plays the same game.
+    void seedShuffle(unsigned long long seed) {
+        state.rng.seed(seed);
+        state.reshuffleRng.seed(~seed);
+    }
+
+    // Use the streams of game number 'game' of a run
+    void seedStreams(const RngStreams &streams, unsigned long long game) {
+        state.rng = streams.stream(game, STREAM_SHUFFLE);
+        state.reshuffleRng = streams.stream(game, STREAM_RESHUFFLE);
+    }
+
+    // Turn console output on/off
+    void setQuiet(bool q) { quiet = q; }
+
+    // Record every game dealt from now on (NULL = stop)
+    void setEventLog(EventLog *log) { events = log; }
+    EventLog *getEventLog() const { return events; }
+
+    // Keep 'cards' up to date with deals and reshuffles (NULL = stop)
+    void setCardTracker(CardTracker *cards) { tracker = cards; }
+
+    // Set configuration directly (used by headless simulation instead of cin)
+    void setGameConfiguration(const GameConfig &c) {
+        config = c;
+        state.numPlayers = c.numPlayers;
+        state.cardsPerPlayer = c.cardsPerPlayer;
+    }
+
+    // Welcome message
+    void displayWelcomeMessage() {
+       cout << "\033[38;2;255;182;193m============================================\n";
+       cout << "           WELCOME TO UNO GAME!\n";
+       cout << "============================================\033[0m\n\n";
+    }
+
+    // Input number of players, names, and cards per player
+    void inputGameConfiguration() {
+        do {
+            cout << "Enter number of players (2-" << MAX_PLAYERS << "): ";
+            cin >> config.numPlayers;
+            if (config.numPlayers < 2 || config.numPlayers > MAX_PLAYERS)
+                cout << "\033[31m ERROR: Enter between 2 and " << MAX_PLAYERS << " players.\033[0m\n";
+        } while (config.numPlayers < 2 || config.numPlayers > MAX_PLAYERS);
+
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        for (int i = 0; i < config.numPlayers; i++) {
+            cout << "Enter name for Player " << i + 1 << ": ";
+            getline(cin, config.playerNames[i]);
+        }
+
+        // Input number of cards per player
+        do {
+            cout << "Enter number of cards per player (5-10): ";
+            cin >> config.cardsPerPlayer;
+            if (config.cardsPerPlayer < 5 || config.cardsPerPlayer > 10)
+                cout << "\033[31m ERROR: Enter between 5 and 10 cards numbers.\033[0m\n";
+        } while (config.cardsPerPlayer < 5 || config.cardsPerPlayer > 10);
+
+        state.numPlayers = config.numPlayers;
+        state.cardsPerPlayer = config.cardsPerPlayer;
+        cout << "\nConfiguration saved!\n\n";
+    }
+
+    // Fill fullDeck with the 108 cards of a UNO deck (done once)
+    void buildFullDeck() {
+        int n = 0;
+        Color colors[] = { RED, BLUE, GREEN, YELLOW };
+
+        // Add number and action cards for each color
+        for (int c = 0; c < 4; c++) {
+            fullDeck[n++] = Card(colors[c], NUMBER, 0);
+            for (int v = 1; v <= 9; v++) {
+                fullDeck[n++] = Card(colors[c], NUMBER, v);
+                fullDeck[n++] = Card(colors[c], NUMBER, v);
+            }
+            for (int s = 0; s < 2; s++) {
+                fullDeck[n++] = Card(colors[c], SKIP, 20);
+                fullDeck[n++] = Card(colors[c], REVERSE, 20);
+                fullDeck[n++] = Card(colors[c], DRAW_TWO, 20);
+            }
+        }
+
+        // Add wild cards
+        for (int w = 0; w < 4; w++) {
+            fullDeck[n++] = Card(WILD, WILD_CARD, 50);
+            fullDeck[n++] = Card(WILD, WILD_DRAW_FOUR, 50);
+        }
+    }
+
+    // Create a full UNO deck
+    void createDeck() {
+        if (!quiet) cout << "Creating Deck...\n";
+        state.lazyDeck = config.lazyDeck;
+        if (events)
+            events->gameStart(state.numPlayers, state.cardsPerPlayer, state.lazyDeck, state.rng,
+                              state.reshuffleRng);
+
+        state.discardPile.clear();
+        if (state.lazyDeck) {
+            // Only the counts: cards are picked as they are drawn
+            state.drawPile.assign(fullDeck, 0);
+            state.drawCounts.reset();
+        } else {
+            // Reset to the full deck and shuffle it in place
+            state.drawPile.assign(fullDeck, DECK_SIZE);
+            shuffleCards(state.drawPile.data(), DECK_SIZE, state.rng);
+        }
+
+        if (!quiet) cout << "Deck created! Total cards: " << state.drawPileSize() << "\n\n";
+    }
+
+    // Deal cards to players
+    void dealCards() {
+        for (int i = 0; i < state.numPlayers; i++)
+            state.hands[i].clear();
+
+        // Take all cards for the deal at once, then hand them out in turn
+        Card dealt[DECK_SIZE];
+        int wanted = state.cardsPerPlayer * state.numPlayers;
+        int got = state.takeCards(dealt, wanted);
+
+        for (int i = 0; i < got; i++) {
+            int p = i % state.numPlayers;
+            state.hands[p].add(dealt[i]);
+        }
+
+        if (got < wanted) {
+            if (!quiet) cout << "Deck ran out while dealing!\n";
+            return;
+        }
+
+        if (!quiet) cout << "Cards dealt successfully!\n\n";
+    }
+
+    // Set initial top card on discard pile
+    void setTopCard() {
+        if (state.lazyDeck && !state.drawCounts.empty()) {
+            state.topCard = state.drawCounts.drawNumber(state.rng);
+            state.discardPile.push(state.topCard);
+        } else {
+            // Look at each remaining card at most once; with many players the
+            // few cards left might contain no number card at all
+            int tries = state.drawPile.size();
+            while (!state.drawPile.empty()) {
+                Card c = state.drawPile.popFront();
+                if (c.getType() == NUMBER || --tries <= 0) {
+                    state.topCard = c;
+                    state.discardPile.push(c);
+                    break;
+                }
+                state.drawPile.pushBack(c);
+            }
+        }
+        if (!quiet) cout << "Initial top card: " << state.topCard.name() << "\n\n";
+        if (tracker) tracker->newGame(state);   // Hands and top card are dealt
+    }
+
+    // Put a played card on the discard pile
+    void discard(Card c) { state.discardPile.push(c); }
+
+    // Shuffle the discard pile (all but its top card) back into the deck
+    void reshuffleDiscardPile() {
+        if (tracker && state.discardPile.size() > 1)
+            tracker->reshuffled(state.discardPile.data(), state.discardPile.size() - 1);
+        int n = state.reshuffleDiscardPile();
+        if (n > 0 && !quiet)
+            cout << "Draw pile empty - discard pile shuffled back in (" << n << " cards).\n";
+    }
+
+    // Draw a card from the deck
+    Card drawCard() {
+        if (state.drawPileSize() == 0) reshuffleDiscardPile();
+        return state.drawCard();
+    }
+
+    // True only when there is nothing left to draw, even after a reshuffle
+    bool isDeckEmpty() const { return !state.canDraw(); }
+    const GameConfig &getConfig() const { return config; }
+    Card getInitialTopCard() const { return state.discardPile.data()[0]; }
+    GameState &getState() { return state; }
+};
+
+// ======================================================
+//                  PLAYER POLICY (BOTS)
+// ======================================================
+// A policy makes the decisions a human would type in with cin.
+// A NULL policy means "ask the human at the keyboard".
+// The game functions take the policy type as a template parameter, so a
+// game where every seat uses the same final bot class calls the bot
+// directly (no virtual call). Mixed seats can still use PlayerPolicy *.
+class PlayerPolicy {
+public:
+    virtual ~PlayerPolicy() {}
+
+    // Called once before any game with the seat number and a seed
+    virtual void setup(int seat, unsigned long long seed) { (void)seat; (void)seed; }
+
+    // Called once with the game the bot sits in. Bots that only look at
+    // their own hand and the top card ignore it; search bots read it.
+    virtual void attach(const GameState *state) { (void)state; }
+
+    // Bots that count cards set this to true; the engine then keeps a
+    // CardTracker up to date and hands it to them here
+    static const bool usesCardTracker = false;
+    virtual void attachTracker(const CardTracker *tracker) { (void)tracker; }
+
+    // Short name for reports
+    virtual const char *botName() const = 0;
+
+    // Return 0 to draw, or the 1-based index of the card to play
+    virtual int chooseCard(const Hand &hand, Card topCard) = 0;
+
+    // Color to pick after playing a wild card
+    virtual Color chooseColor(const Hand &hand) = 0;
+
+    // Whether the player says "UNO" when down to one card
+    virtual bool callUNO() = 0;
+
+    // House-rule choices (see HOUSE RULES). By default a bot takes every
+    // chance it gets; a bot that knows better overrides them.
+
+    // Stacking: 'pendingDraw' cards are coming. Return the 1-based index
+    // of a +2 to pass them on with, or 0 to draw them all
+    virtual int chooseStack(const Hand &hand, int pendingDraw) {
+        (void)pendingDraw;
+        for (int i = 0; i < hand.size(); i++)
+            if (hand[i].getType() == DRAW_TWO) return i + 1;
+        return 0;
+    }
+
+    // Jump-in: whether to play our copy of 'topCard' out of turn
+    virtual bool chooseJumpIn(const Hand &hand, Card topCard) {
+        (void)hand; (void)topCard;
+        return true;
+    }
+
+    // Draw until playable: whether to play 'drawn', which fits 'topCard',
+    // straight away instead of ending the turn
+    virtual bool playDrawnCard(const Hand &hand, Card drawn, Card topCard) {
+        (void)hand; (void)drawn; (void)topCard;
+        return true;
+    }
+
+    // 7-0: seat to swap hands with after playing a 7 (the smallest hand)
+    virtual int chooseSwap(const Hand &hand, const int handSizes[], int numPlayers) {
+        int other = -1;
+        for (int p = 0; p < numPlayers; p++)
+            if (p != hand.seat && (other < 0 || handSizes[p] < handSizes[other])) other = p;
+        return other;
+    }
+};
+
+// Color the hand holds most of (wild cards not counted), red on a tie
+Color majorityColor(const Hand &hand) { return hand.bits.majorityColor(); }
+
+// Simple bot: plays the first valid card, picks the color it holds most of
+class FirstPlayableBot final : public PlayerPolicy {
+public:
+    const char *botName() const { return "first"; }
+
+    int chooseCard(const Hand &hand, Card topCard) {
+        return legalMoves(hand, topCard).first() + 1;   // -1 + 1 = 0 means draw
+    }
+
+    Color chooseColor(const Hand &hand) { return majorityColor(hand); }
+
+    bool callUNO() { return true; }
+};
+
+// Plays a random valid card and picks a random color
+class RandomBot final : public PlayerPolicy {
+private:
+    Rng rng;
+
+public:
+    void setup(int seat, unsigned long long seed) { rng.seed(seed + seat); }
+
+    const char *botName() const { return "random"; }
+
+    int chooseCard(const Hand &hand, Card topCard) {
+        MoveMask moves = legalMoves(hand, topCard);
+        int n = moves.count();
+        if (n == 0) return 0;
+
+        // Walk to the k-th playable slot
+        int k = (int)rng.below((unsigned int)n);
+        for (int i = 0; i < hand.size(); i++)
+            if (moves.test(i) && k-- == 0) return i + 1;
+        return 0;
+    }
+
+    Color chooseColor(const Hand &hand) {
+        (void)hand;
+        return (Color)rng.below(4);
+    }
+
+    bool callUNO() { return true; }
+};
+
+// Gets rid of its most expensive card first (highest Card::getValue())
+class GreedyBot final : public PlayerPolicy {
+public:
+    const char *botName() const { return "greedy"; }
+
+    int chooseCard(const Hand &hand, Card topCard) {
+        MoveMask moves = legalMoves(hand, topCard);
+        int best = -1;
+        for (int i = 0; i < hand.size(); i++)
+            if (moves.test(i) && (best < 0 || hand[i].getValue() > hand[best].getValue()))
+                best = i;
+        return best + 1;
+    }
+
+    Color chooseColor(const Hand &hand) { return majorityColor(hand); }
+
+    bool callUNO() { return true; }
+};
+
+// Tries to keep play on the color it holds most of: plays a card of that
+// color if it can, then any other colored card, and saves wilds for last
+class ColorMajorityBot final : public PlayerPolicy {
+public:
+    const char *botName() const { return "color"; }
+
+    int chooseCard(const Hand &hand, Card topCard) {
+        MoveMask moves = legalMoves(hand, topCard);
+        Color favorite = majorityColor(hand);
+        int best = -1, bestRank = 3;
+        for (int i = 0; i < hand.size(); i++) {
+            if (!moves.test(i)) continue;
+            int rank = hand[i].getColor() == favorite ? 0 : (hand[i].getColor() == WILD ? 2 : 1);
+            if (rank < bestRank) {
+                best = i;
+                bestRank = rank;
+            }
+        }
+        return best + 1;
+    }
+
+    Color chooseColor(const Hand &hand) { return majorityColor(hand); }
+
+    bool callUNO() { return true; }
+};
+
+// Counts cards: of the cards it can play, plays the one the fewest unseen
+// cards fit on (so the next player is least likely to have an answer),
+// keeping wilds for last. Picks the color it holds most of, and on a tie
+// the one with the fewest unseen cards.
+class CardCountingBot final : public PlayerPolicy {
+private:
+    const CardTracker *tracker;
+    int seat;
+
+public:
+    CardCountingBot() : tracker(NULL), seat(0) {}
+
+    static const bool usesCardTracker = true;
+    void setup(int s, unsigned long long seed) {
+        (void)seed;
+        seat = s;
+    }
+    void attachTracker(const CardTracker *t) { tracker = t; }
+
+    const char *botName() const { return "count"; }
+
+    int chooseCard(const Hand &hand, Card topCard) {
+        MoveMask moves = legalMoves(hand, topCard);
+        if (!tracker) return moves.first() + 1;
+        const UnseenCards &unseen = tracker->unseenBy(seat);
+
+        int best = -1, bestAnswers = 0;
+        for (int i = 0; i < hand.size(); i++) {
+            if (!moves.test(i)) continue;
+            int answers = hand[i].getColor() == WILD ? DECK_SIZE : unseen.playableOn(hand[i]);
+            if (best < 0 || answers < bestAnswers) {
+                best = i;
+                bestAnswers = answers;
+            }
+        }
+        return best + 1;
+    }
+
+    Color chooseColor(const Hand &hand) {
+        int counts[4] = {0, 0, 0, 0};
+        for (int i = 0; i < hand.size(); i++)
+            if (hand[i].getColor() >= RED && hand[i].getColor() <= YELLOW)
+                counts[hand[i].getColor()]++;
+
+        int best = 0;
+        for (int c = 1; c < 4; c++)
+            if (counts[c] > counts[best] ||
+                (counts[c] == counts[best] && tracker &&
+                 tracker->unseenBy(seat).color[c] < tracker->unseenBy(seat).color[best]))
+                best = c;
+        return (Color)best;
+    }
+
+    bool callUNO() { return true; }
+};
+
+// Kinds of built-in bots
+enum BotKind { FIRST_BOT = 0, RANDOM_BOT = 1, GREEDY_BOT = 2, COLOR_BOT = 3, NUM_BOT_KINDS = 4 };
+
+// One of the built-in bots, chosen by kind. Dispatches with a switch, so
+// seats with different bots still avoid virtual calls in the game loop.
+// setup() gives seat i the kind i % NUM_BOT_KINDS unless setKind() was used.
+class BotByKind final : public PlayerPolicy {
+private:
+    BotKind kind;
+    bool kindFixed;
+    FirstPlayableBot first;
+    RandomBot random;
+    GreedyBot greedy;
+    ColorMajorityBot color;
+
+public:
+    BotByKind() : kind(FIRST_BOT), kindFixed(false) {}
+
+    void setKind(BotKind k) {
+        kind = k;
+        kindFixed = true;
+    }
+    BotKind getKind() const { return kind; }
+
+    void setup(int seat, unsigned long long seed) {
+        if (!kindFixed) kind = (BotKind)(seat % NUM_BOT_KINDS);
+        random.setup(seat, seed);
+    }
+
+    const char *botName() const {
+        switch (kind) {
+            case RANDOM_BOT: return random.botName();
+            case GREEDY_BOT: return greedy.botName();
+            case COLOR_BOT:  return color.botName();
+            default:         return first.botName();
+        }
+    }
+
+    int chooseCard(const Hand &hand, Card topCard) {
+        switch (kind) {
+            case RANDOM_BOT: return random.chooseCard(hand, topCard);
+            case GREEDY_BOT: return greedy.chooseCard(hand, topCard);
+            case COLOR_BOT:  return color.chooseCard(hand, topCard);
+            default:         return first.chooseCard(hand, topCard);
+        }
+    }
+
+    Color chooseColor(const Hand &hand) {
+        switch (kind) {
+            case RANDOM_BOT: return random.chooseColor(hand);
+            case GREEDY_BOT: return greedy.chooseColor(hand);
+            case COLOR_BOT:  return color.chooseColor(hand);
+            default:         return first.chooseColor(hand);
+        }
+    }
+
+    bool callUNO() { return true; }
+};
+
+// ======================================================
+//                     HOUSE RULES
+// ======================================================
+// A rule set is a type with one constexpr flag per house rule. The rules
+// code (GameRulesT, playerTurn, runGame) takes it as a template argument
+// and tests the flags with 'if constexpr', so every rule set gets its own
+// copy of that code and a rule that is off leaves nothing behind - see
+// the fullGameRules benchmarks.
+// Only GameEngine and runGame know about house rules: the move/undo
+// layer, ISMCTS, the batch engine and replays play StandardRules.
+// "--rules <name>" picks the set for --sim, --match, --farm and the
+// interactive game (see withRules).
+struct StandardRules {
+    static constexpr const char *name = "standard";
+    static constexpr bool stackDrawTwo = false;           // +2 on a +2 passes the penalty on
+    static constexpr bool sevenZero = false;              // 7 swaps two hands, 0 passes all hands on
+    static constexpr bool jumpIn = false;                 // The same card may be played out of turn
+    static constexpr bool drawUntilPlayable = false;      // Draw until a card fits, not just one
+    static constexpr bool reverseSkipsTwoPlayers = true;  // Reverse acts like skip with 2 players
+};
+
+struct StackingRules : StandardRules {
+    static constexpr const char *name = "stacking";
+    static constexpr bool stackDrawTwo = true;
+};
+
+struct SevenZeroRules : StandardRules {
+    static constexpr const char *name = "sevenZero";
+    static constexpr bool sevenZero = true;
+};
+
+struct JumpInRules : StandardRules {
+    static constexpr const char *name = "jumpIn";
+    static constexpr bool jumpIn = true;
+};
+
+struct DrawUntilPlayableRules : StandardRules {
+    static constexpr const char *name = "drawUntil";
+    static constexpr bool drawUntilPlayable = true;
+};
+
+// Reverse only turns the direction, also with 2 players (so the same
+// player moves again after the other one)
+struct PlainReverseRules : StandardRules {
+    static constexpr const char *name = "plainReverse";
+    static constexpr bool reverseSkipsTwoPlayers = false;
+};
+
+// All of the above at once
+struct HouseRules : StandardRules {
+    static constexpr const char *name = "house";
+    static constexpr bool stackDrawTwo = true;
+    static constexpr bool sevenZero = true;
+    static constexpr bool jumpIn = true;
+    static constexpr bool drawUntilPlayable = true;
+};
+
+// Calls fn(Rules()) with the rule set named on the command line.
+// False if unknown.
+template <class Fn>
+bool withRules(const string &name, Fn fn) {
+    if (name == StandardRules::name)          { fn(StandardRules()); return true; }
+    if (name == StackingRules::name)          { fn(StackingRules()); return true; }
+    if (name == SevenZeroRules::name)         { fn(SevenZeroRules()); return true; }
+    if (name == JumpInRules::name)            { fn(JumpInRules()); return true; }
+    if (name == DrawUntilPlayableRules::name) { fn(DrawUntilPlayableRules()); return true; }
+    if (name == PlainReverseRules::name)      { fn(PlainReverseRules()); return true; }
+    if (name == HouseRules::name)             { fn(HouseRules()); return true; }
+    return false;
+}
+
+// House-rule question for a human player ("y" or "yes" means yes)
+bool askYesNo(const string &question) {
+    cout << question << " (y/n): ";
+    string answer;
+    if (!(cin >> answer)) return false;
+    for (int i = 0; i < (int)answer.size(); i++) answer[i] = tolower(answer[i]);
+    return answer == "y" || answer == "yes";
+}
+
+// ======================================================
+//               MODULE 2: PLAYER MANAGEMENT
+// ======================================================
+// This class handles all player-related actions in the UNO game
+class PlayerManagement {
+private:
+    bool quiet;          // true = no console output (headless simulation)
+    EventLog *events;    // NULL = no event log
+    CardTracker *tracker; // NULL = nobody counts cards
+
+public:
+    PlayerManagement() : quiet(false), events(NULL), tracker(NULL) {}
+
+    // Turn console output on/off
+    void setQuiet(bool q) { quiet = q; }
+
+    // Record plays, draws and UNO penalties (NULL = stop)
+    void setEventLog(EventLog *log) { events = log; }
+
+    // Tell 'cards' about plays, draws and UNO penalties (NULL = stop)
+    void setCardTracker(CardTracker *cards) { tracker = cards; }
+
+    // -------------------------------------------------
+    // Display all cards in a player's hand
+    // -------------------------------------------------
+    void displayPlayerHand(const string &name, const Hand &hand) {
+        cout << "\n--- " << name << "'s Hand ---\n";   // Display player name
+        for (int i = 0; i < hand.size(); i++)           // Loop through player's cards
+            cout << i + 1 << ". " << hand[i].name() << endl;  // Show each card with index
+        cout << endl;
+    }
+
+    // -------------------------------------------------
+    // Check whether the played card is valid or not
+    // -------------------------------------------------
+    // (the rules themselves are in makeMoveTable)
+    bool isValidMove(Card played, Card top) {
+        return cardFits(played, top);
+    }
+
+    // -------------------------------------------------
+    // Check whether the player correctly calls UNO
+    // -------------------------------------------------
+    template <class Policy = PlayerPolicy>
+    void checkUNO(const string &name, Hand &hand, DeckManagement &deck,
+                  Policy *policy = NULL) {
+
+        // If player has only 1 card left
+        if (hand.size() == 1) {
+
+            bool saidUNO;
+            if (policy) {
+                saidUNO = policy->callUNO();
+            } else {
+                cout << "\nYou have 1 card left! Say 'UNO': ";
+                string call;
+                cin >> call;
+                saidUNO = (call == "UNO" || call == "uno");
+            }
+
+            // If player fails to say UNO correctly
+            if (!saidUNO) {
+                if (!quiet) cout << "\nYou failed to say UNO! Drawing 2 penalty cards.\n";
+
+                // Draw two penalty cards
+                for (int i = 0; i < 2; i++) {
+                    if (deck.isDeckEmpty()) break;
+                    Card c = deck.drawCard();
+                    hand.add(c);
+                    if (events) events->penalty(hand.seat, c);
+                    if (tracker) tracker->drew(hand.seat, c);
+                }
+            }
+        }
+    }
+
+    // -------------------------------------------------
+    // Handles the complete turn of a single player
+    // -------------------------------------------------
+    template <class Rules = StandardRules, class Policy = PlayerPolicy>
+    bool playerTurn(const string &name, Hand &hand, Card &topCard,
+                    DeckManagement &deck, bool &playedThisTurn,
+                    Policy *policy = NULL)
+    {
+        playedThisTurn = false;   // Assume no card is played initially
+
+        if (!quiet) {
+            // Display the player's hand
+            displayPlayerHand(name, hand);
+
+            // Display the top card on the discard pile
+            cout << "Top card: " << topCard.name() << endl;
+
+            // If the top card is a wild card, show chosen color
+            if (topCard.getType() == WILD_CARD || topCard.getType() == WILD_DRAW_FOUR)
+                cout << "Current color: " << topCard.getColorNameColored() << endl;
+        }
+
+        // Ask player (or bot) to choose a card number or 0 to draw
+        int choice;
+        if (policy) {
+            choice = policy->chooseCard(hand, topCard);
+        } else {
+            cout << name << ", choose a card to play (0 to draw): ";
+            cin >> choice;
+        }
+
+        // -------------------------------------------------
+        // If player chooses to draw a card
+        // (until one can be played, with drawUntilPlayable,
+        // and then the player may play it at once)
+        // -------------------------------------------------
+        if (choice == 0) {
+            bool playDrawn = false;
+            if (!deck.isDeckEmpty()) {
+                Card newCard;
+                do {
+                    newCard = deck.drawCard();
+                    if (!quiet) cout << "You drew: " << newCard.name() << "\n";
+                    hand.add(newCard);   // Add drawn card to hand
+                    if (events) events->draw(hand.seat, newCard);
+                    if (tracker) tracker->drew(hand.seat, newCard);
+                } while (Rules::drawUntilPlayable && !isValidMove(newCard, topCard) &&
+                         !deck.isDeckEmpty());
+
+                if constexpr (Rules::drawUntilPlayable) {
+                    if (isValidMove(newCard, topCard))
+                        playDrawn = policy ? policy->playDrawnCard(hand, newCard, topCard)
+                                           : askYesNo(string("Play ") + newCard.name() + " now?");
+                }
+            } else if (!quiet) {
+                cout << "Deck is empty  cannot draw.\n";
+            }
+            if (!playDrawn) return false;   // Turn ends without playing
+            choice = hand.size();           // The drawn card is the last one
+        }
+
+        // -------------------------------------------------
+        // Validate the selected card index
+        // -------------------------------------------------
+        int index = choice - 1;
+        if (index < 0 || index >= hand.size()) {
+            if (!quiet) cout << "Invalid choice! You draw 1 card.\n";
+            if (!deck.isDeckEmpty()) {
+                hand.add(deck.drawCard());
+                if (!quiet) cout << "You drew: " << hand[hand.size() - 1].name() << "\n";
+                if (events) events->draw(hand.seat, hand[hand.size() - 1]);
+                if (tracker) tracker->drew(hand.seat, hand[hand.size() - 1]);
+            }
+            return false;
+        }
+
+        // -------------------------------------------------
+        // Validate whether the selected card is playable
+        // -------------------------------------------------
+        if (!isValidMove(hand[index], topCard)) {
+            if (!quiet) cout << "Invalid move! You draw 1 card.\n";
+            if (!deck.isDeckEmpty()) {
+                hand.add(deck.drawCard());
+                if (!quiet) cout << "You drew: " << hand[hand.size() - 1].name() << "\n";
+                if (events) events->draw(hand.seat, hand[hand.size() - 1]);
+                if (tracker) tracker->drew(hand.seat, hand[hand.size() - 1]);
+            }
+            return false;
+        }
+
+        // -------------------------------------------------
+        // VALID MOVE
+        // -------------------------------------------------
+        if (!quiet) cout << name << " played: " << hand[index].name() << endl;
+
+        // Remove the played card from the player's hand, it becomes the top card
+        if (events) events->play(hand.seat, hand[index]);
+        if (tracker) tracker->played(hand.seat, hand[index]);
+        topCard = hand.removeAt(index);
+        deck.discard(topCard);    // Keep it on the discard pile
+        playedThisTurn = true;    // Mark that a card was played
+
+        // -------------------------------------------------
+        // WIN CHECK
+        // -------------------------------------------------
+        if (hand.empty()) {
+            if (!quiet)
+                cout << "\n" << name << " has no cards left! " 
+                     << name << " WINS the game!\n";
+            return true;   // Game ends
+        }
+
+        // Check for UNO rule
+        checkUNO(name, hand, deck, policy);
+
+        return false;  // Game continues
+    }
+};
+
+
+// ======================================================
+//                     GAME RULES
+// ======================================================
+// This class handles all the game rules like direction, special cards, etc.
+// Direction and the effect flag are kept in the GameState.
+// Rules is the set of house rules in play (see HOUSE RULES).
+template <class Rules>
+class GameRulesT {
+private:
+    GameState &state;
+    bool quiet;           // true = no console output (headless simulation)
+    EventLog *events;     // NULL = no event log
+    CardTracker *tracker; // NULL = nobody counts cards
+
+    // Next player draws n cards as a penalty (+2 / +4)
+    void drawPenalty(Hand &hand, int n, DeckManagement &deck) {
+        for (int i = 0; i < n; i++) {
+            if (deck.isDeckEmpty()) continue;
+            Card c = deck.drawCard();
+            hand.add(c);
+            if (events) events->penalty(hand.seat, c);
+            if (tracker) tracker->drew(hand.seat, c);
+        }
+    }
+
+    // Card i of 'hand' played outside playerTurn (stacked +2, jump-in)
+    void playFromHand(Hand &hand, int i, DeckManagement &deck) {
+        if (!quiet) cout << "Player " << hand.seat + 1 << " played: " << hand[i].name() << endl;
+        if (events) events->play(hand.seat, hand[i]);
+        if (tracker) tracker->played(hand.seat, hand[i]);
+        state.topCard = hand.removeAt(i);
+        deck.discard(state.topCard);
+    }
+
+    // 7-0 rule: a 7 swaps the player's hand with another player's (the
+    // bot or the human picks whose), a 0 passes every hand on to the next
+    // player in the direction of play
+    template <class Policy>
+    void passHands(Card playedCard, int currentPlayer, int numPlayers, Hand playerHands[],
+                   Policy *policy) {
+        int dest[MAX_PLAYERS];   // Seat each hand goes to
+        for (int p = 0; p < numPlayers; p++) dest[p] = p;
+
+        if (playedCard.getTypeValue() == 7) {
+            int other = -1;
+            if (policy) {
+                int sizes[MAX_PLAYERS];
+                for (int p = 0; p < numPlayers; p++) sizes[p] = playerHands[p].size();
+                other = policy->chooseSwap(playerHands[currentPlayer], sizes, numPlayers);
+                if (other < 0 || other >= numPlayers || other == currentPlayer)
+                    other = nextPlayer(currentPlayer);
+            } else {
+                do {
+                    cout << "Swap hands with player (1-" << numPlayers << "): ";
+                    string choice;
+                    if (!(cin >> choice)) other = nextPlayer(currentPlayer);
+                    else other = atoi(choice.c_str()) - 1;
+                } while (other < 0 || other >= numPlayers || other == currentPlayer);
+            }
+            if (!quiet)
+                cout << "Player " << currentPlayer + 1 << " swaps hands with player " << other + 1 << "!\n";
+            dest[currentPlayer] = other;
+            dest[other] = currentPlayer;
+        } else {
+            if (!quiet) cout << "Every hand is passed on!\n";
+            for (int p = 0; p < numPlayers; p++) dest[p] = nextPlayer(p);
+        }
+
+        Hand old[MAX_PLAYERS];
+        for (int p = 0; p < numPlayers; p++) old[p] = playerHands[p];
+        if (tracker) tracker->handsPassed(dest, old);
+        for (int p = 0; p < numPlayers; p++)
+            if (dest[p] != p) playerHands[dest[p]].setCards(old[p]);
+    }
+
+public:
+    GameRulesT(GameState &s) : state(s), quiet(false), events(NULL), tracker(NULL) {}
+
+    // Turn console output on/off
+    void setQuiet(bool q) { quiet = q; }
+
+    // Record penalties, color choices and direction changes (NULL = stop)
+    void setEventLog(EventLog *log) { events = log; }
+
+    // Tell 'cards' about penalty draws (NULL = stop)
+    void setCardTracker(CardTracker *cards) { tracker = cards; }
+
+    // Back to the starting state so another game can be played:
+    // clockwise, first player to move
+    void reset() {
+        state.isClockwise = true;
+        state.effectApplied = false;
+        state.currentPlayer = 0;
+        state.pendingDraw = 0;
+    }
+
+    // This function returns the index of the next player based on direction
+    // (the turn order itself is GameState::nextPlayer)
+    int nextPlayer(int current) { return state.nextPlayer(current); }
+
+    // This function reverses the direction of play
+    void reverseDirection() { 
+        state.isClockwise = !state.isClockwise;  // Toggles direction
+    }
+
+    // Converts user input string into a Color enum value
+    Color parseColor(string input) {
+        // Convert all letters of input to lowercase
+        for (int i = 0; i < (int)input.size(); i++)
+            input[i] = tolower(input[i]);
+
+        // Match input with valid colors
+        if (input == "red") return RED;
+        if (input == "blue") return BLUE;
+        if (input == "green") return GREEN;
+        if (input == "yellow") return YELLOW;
+
+        // If input does not match any valid color
+        return UNKNOWN_COLOR;
+    }
+
+    // Resets the special card effect flag for the next turn
+    void resetEffectFlag() { 
+        state.effectApplied = false; 
+    }
+
+    // Stacking rule: at the start of a turn with +2 cards pending, the
+    // player may play a +2 and pass the penalty on, two cards bigger;
+    // otherwise they draw it all and lose the turn. 'policy' (NULL = a
+    // human) chooses.
+    // Returns false if the turn goes ahead as normal.
+    template <class Policy>
+    bool answerDrawTwo(int player, Hand playerHands[], DeckManagement &deck, bool &stacked,
+                       Policy *policy) {
+        stacked = false;
+        if constexpr (Rules::stackDrawTwo) {
+            if (state.pendingDraw == 0) return false;
+            Hand &hand = playerHands[player];
+            int choice = 0;
+            if (policy) {
+                choice = policy->chooseStack(hand, state.pendingDraw);
+            } else if (hand.bits.hasType(DRAW_TWO)) {
+                cout << "\n" << (int)state.pendingDraw << " cards to draw. Your +2 cards:\n";
+                for (int i = 0; i < hand.size(); i++)
+                    if (hand[i].getType() == DRAW_TWO) cout << i + 1 << ". " << hand[i].name() << "\n";
+                cout << "Choose one to pass them on (0 to draw): ";
+                string answer;
+                if (cin >> answer) choice = atoi(answer.c_str());
+            }
+            if (choice >= 1 && choice <= hand.size() && hand[choice - 1].getType() == DRAW_TWO) {
+                playFromHand(hand, choice - 1, deck);
+                state.pendingDraw += 2;
+                stacked = true;
+                return true;
+            }
+            if (!quiet) cout << "Player " << player + 1 << " draws " << (int)state.pendingDraw << " cards!\n";
+            drawPenalty(hand, state.pendingDraw, deck);
+            state.pendingDraw = 0;
+            return true;
+        } else {
+            (void)player; (void)playerHands; (void)deck; (void)policy;
+            return false;
+        }
+    }
+
+    // Jump-in rule: right after a play, the other players (in the
+    // direction of play) holding the very same colored card are asked in
+    // turn through policies[p] (NULL = a human); the first who wants to
+    // plays it out of turn, and play goes on from them.
+    // Returns their index, or -1 if nobody jumps in.
+    template <class Policy>
+    int jumpIn(int player, Hand playerHands[], DeckManagement &deck, Policy *policies[]) {
+        if constexpr (Rules::jumpIn) {
+            Card top = state.topCard;
+            if (top.getTypeValue() >= WILD_CARD) return -1;
+            for (int p = nextPlayer(player); p != player; p = nextPlayer(p)) {
+                Hand &hand = playerHands[p];
+                for (int i = 0; i < hand.size(); i++) {
+                    if (hand[i].code != top.code) continue;
+                    bool jump = policies[p]
+                        ? policies[p]->chooseJumpIn(hand, top)
+                        : askYesNo("Player " + to_string(p + 1) + ", jump in with " + top.name() + "?");
+                    if (!jump) break;   // Next player
+                    playFromHand(hand, i, deck);
+                    return p;
+                }
+            }
+            return -1;
+        } else {
+            (void)player; (void)playerHands; (void)deck; (void)policies;
+            return -1;
+        }
+    }
+
+    // This function applies special effects of cards like SKIP, DRAW_TWO, WILD, etc.
+    template <class Policy = PlayerPolicy>
+    void applySpecialCard(Card &playedCard,      // The card that was just played
+                          int &currentPlayer,    // Current player's index (passed by reference)
                           int numPlayers,        // Total number of players
-                          Card playerHands[][50],// 2D array storing all player cards
-                          int handSizes[],       // Stores number of cards each player has
-                          DeckManagement &deck)  // Deck object to draw more cards
+                          Hand playerHands[],    // Hands of all players
+                          DeckManagement &deck,  // Deck object to draw more cards
+                          Policy *policy = NULL) // Bot of the current player (NULL = human)
     {
         // Stop if effect was already applied
-        if (effectApplied) return;
+        if (state.effectApplied) return;
+
+        // If card is a normal number card, no special effect applies
+        // (apart from 7 and 0 with the 7-0 rule)
+        if (playedCard.getType() == NUMBER) {
+            if constexpr (Rules::sevenZero) {
+                if (playedCard.getTypeValue() == 7 || playedCard.getTypeValue() == 0) {
+                    passHands(playedCard, currentPlayer, numPlayers, playerHands, policy);
+                    state.effectApplied = true;
+                }
+            }
+            return;
+        }
+
+        // Apply effect based on card type
+        switch (playedCard.getType()) {
+
+            // -------- SKIP CARD --------
+            case SKIP: {
+                if (!quiet) cout << "Next player is skipped!\n";
+                currentPlayer = nextPlayer(currentPlayer); // Skip next player
+                break;
+            }
+
+            // -------- REVERSE CARD --------
+            case REVERSE: {
+                if (Rules::reverseSkipsTwoPlayers && numPlayers == 2) {
+                    // With only 2 players, reverse acts like skip
+                    if (!quiet) cout << "Reverse card played!\n";
+                    currentPlayer = nextPlayer(currentPlayer);
+                } else {
+                    // Otherwise reverse direction
+                    if (!quiet) cout << "Direction reversed!\n";
+                    reverseDirection();
+                    if (events) events->direction(currentPlayer, state.isClockwise);
+                }
+                break;
+            }
+
+            // -------- DRAW TWO CARD --------
+            case DRAW_TWO: {
+                if constexpr (Rules::stackDrawTwo) {
+                    // The next player answers it first thing in their turn
+                    state.pendingDraw += 2;
+                } else {
+                    int next = nextPlayer(currentPlayer);
+                    if (!quiet) cout << "Player " << next + 1 << " draws 2 cards!\n";
+
+                    // Next player draws two cards from the deck
+                    drawPenalty(playerHands[next], 2, deck);
+
+                    currentPlayer = next; // Turn moves to the next player
+                }
+                break;
+            }
+
+            // -------- WILD CARD --------
+            case WILD_CARD: {
+                // A bot picks its color directly
+                if (policy) {
+                    playedCard.setColor(policy->chooseColor(playerHands[currentPlayer]));
+                    if (events) events->color(currentPlayer, playedCard.getColor());
+                    break;
+                }
+
+                string choice;
+
+                // Keep asking until valid color is entered
+                do {
+                    cout << "Choose a color: "
+                         << RED_COLOR << "red "
+                         << BLUE_COLOR << "blue "
+                         << GREEN_COLOR << "green "
+                         << YELLOW_COLOR << "yellow"
+                         << RESET_COLOR << "\n";
+
+                    cin >> choice;
+                    playedCard.setColor(parseColor(choice));
+
+                    // Display error for invalid input
+                    if (playedCard.getColor() == UNKNOWN_COLOR)
+                        cout << "\033[31mERROR: Invalid color. Please enter red, blue, green, or yellow.\033[0m\n";
+
+                } while (playedCard.getColor() == UNKNOWN_COLOR);
+
+                cout << "Color chosen: " << playedCard.getColorNameColored() << "\n";
+                if (events) events->color(currentPlayer, playedCard.getColor());
+                break;
+            }
+
+            // -------- WILD DRAW FOUR CARD --------
+            case WILD_DRAW_FOUR: {
+                int next = nextPlayer(currentPlayer);
+
+                if (!quiet) cout << "Player " << next + 1 << " draws 4 cards!\n";
+
+                // Next player draws four cards
+                drawPenalty(playerHands[next], 4, deck);
+
+                // A bot picks its color directly
+                if (policy) {
+                    playedCard.setColor(policy->chooseColor(playerHands[currentPlayer]));
+                    if (events) events->color(currentPlayer, playedCard.getColor());
+                    currentPlayer = next;
+                    break;
+                }
+
+                // Keep asking until valid color is entered
+                string choice;
+                do {
+                    cout << "Choose a color: "
+                         << RED_COLOR << "red "
+                         << BLUE_COLOR << "blue "
+                         << GREEN_COLOR << "green "
+                         << YELLOW_COLOR << "yellow"
+                         << RESET_COLOR << "\n";
+
+                    cin >> choice;
+                    playedCard.setColor(parseColor(choice));
+
+                    // Display error for invalid input
+                    if (playedCard.getColor() == UNKNOWN_COLOR)
+                        cout << "\033[31mERROR: Invalid color. Please enter red, blue, green, or yellow.\033[0m\n";
+
+                } while (playedCard.getColor() == UNKNOWN_COLOR);
+
+                cout << "Color chosen: " << playedCard.getColorNameColored() << "\n";
+                if (events) events->color(currentPlayer, playedCard.getColor());
+
+                // Turn also moves to the next player
+                currentPlayer = next;
+                break;
+            }
+        }
+
+        // Mark effect as applied so it does not repeat
+        state.effectApplied = true;
+    }
+};
+
+// The official rules
+typedef GameRulesT<StandardRules> GameRules;
+
+// ======================================================
+//                      GAME LOOP
+// ======================================================
+// Plays one game from the dealt GameState the modules work on.
+// policies[p] == NULL means player p is a human typing at the keyboard.
+// Returns the index of the winner, or -1 if no card is left to draw
+// anywhere (all cards are in hands) - only then is the game a draw.
+
+// A player emptied their hand with a card played outside playerTurn
+// (stacked +2 or jump-in)
+int winOutOfTurn(DeckManagement &module1, const string &name, int player, bool quiet) {
+    if (!quiet) cout << "\n" << name << " has no cards left! " << name << " WINS the game!\n";
+    if (module1.getEventLog()) module1.getEventLog()->gameEnd(player);
+    return player;
+}
+
+template <class Policy, class Rules>
+int runGame(DeckManagement &module1, PlayerManagement &module2, GameRulesT<Rules> &module3,
+            Policy *policies[], bool quiet)
+{
+    GameState &state = module1.getState();
+    const GameConfig &config = module1.getConfig();
+
+    // Main game loop
+    while (!module1.isDeckEmpty()) {
+        int player = state.currentPlayer;
+        if (!quiet)
+            cout << "\n--- " << config.playerNames[player] << "'s TURN ---\n";
+
+        bool playedThisTurn = false;
+
+        // A pending stack of +2 is answered instead of a normal turn
+        if (module3.answerDrawTwo(player, state.hands, module1, playedThisTurn, policies[player])) {
+            if (playedThisTurn) {
+                if (state.hands[player].empty())
+                    return winOutOfTurn(module1, config.playerNames[player], player, quiet);
+                module2.checkUNO(config.playerNames[player], state.hands[player], module1,
+                                 policies[player]);
+            }
+            state.currentPlayer = module3.nextPlayer(player);
+            continue;
+        }
+
+        bool won = module2.playerTurn<Rules>(
+            config.playerNames[player],
+            state.hands[player],
+            state.topCard,
+            module1,
+            playedThisTurn,
+            policies[player]
+        );
+
+        if (playedThisTurn) {
+            module3.resetEffectFlag();  // allow special card effect
+        }
+
+        if (won) {
+            if (module1.getEventLog()) module1.getEventLog()->gameEnd(player);
+            return player;
+        }
+
+        // Someone holding the same card may jump in, the effect is then theirs
+        if (playedThisTurn) {
+            int jumper = module3.jumpIn(player, state.hands, module1, policies);
+            if (jumper >= 0) {
+                player = state.currentPlayer = jumper;
+                if (state.hands[player].empty())
+                    return winOutOfTurn(module1, config.playerNames[player], player, quiet);
+                module2.checkUNO(config.playerNames[player], state.hands[player], module1,
+                                 policies[player]);
+            }
+        }
+
+        // Apply special card effects
+        module3.applySpecialCard(
+            state.topCard,
+            state.currentPlayer,
+            state.numPlayers,
+            state.hands,
+            module1,
+            policies[player]
+        );
+
+        // Move to next player
+        state.currentPlayer = module3.nextPlayer(state.currentPlayer);
+    }
+
+    if (module1.getEventLog()) module1.getEventLog()->gameEnd(-1);
+    return -1;
+}
+
+// ======================================================
+//                  MOVE / UNDO LAYER
+// ======================================================
+// One complete turn applied straight to a GameState, with the same rules
+// as playerTurn + checkUNO + applySpecialCard + nextPlayer in runGame, but
+// with the decisions given up front and no console I/O. Every change is
+// written to a MoveUndo record so undoMove() can restore the state exactly,
+// which lets a search walk a game tree on one state without copying it.
+
+// A decision for the player to move
+struct Move {
+    signed char slot;      // Hand index of the card to play, -1 = draw a card
+    unsigned char color;   // Color chosen if the card is a wild card
+    bool callUNO;          // Says "UNO" when going down to one card
+
+    static Move draw() { Move m = {-1, RED, true}; return m; }
+    static Move play(int slot, Color color = RED) {
+        Move m = {(signed char)slot, (unsigned char)color, true};
+        return m;
+    }
+};
+
+// At most: 2 UNO penalty cards + 4 from a +4 (drawing instead of playing is 1)
+const int MAX_DRAWS_PER_MOVE = 6;
+
+// Upper bound on the number of distinct moves in one position
+const int MAX_MOVES = 1 + HAND_CAPACITY * 4;
+
+// Everything applyMove() changed, in the order it changed it
+struct MoveUndo {
+    Card oldTopCard;
+    Card played;                 // Card taken from the hand (if slot >= 0)
+    signed char slot;
+    unsigned char player;        // Player who made the move
+    unsigned char oldCurrentPlayer;
+    bool oldClockwise;
+    bool oldEffectApplied;
+
+    unsigned char drawCount;
+    unsigned char drawnBy[MAX_DRAWS_PER_MOVE];   // Hand each drawn card went to
+    signed char reshuffleAt;     // Draw index at which the discard pile was reshuffled, -1 = none
+
+    // Piles and generator just before the reshuffle (only filled if reshuffleAt >= 0)
+    CardRing oldDrawPile;
+    DiscardPile oldDiscardPile;
+    Rng oldRng;
+    unsigned char oldHeldDrawn;  // Lazy deck's held cards drawn before the move
+};
+
+// Draw one card for player p while recording it in u
+void drawForUndo(GameState &s, int p, MoveUndo &u) {
+    if (s.lazyDeck && u.drawCount == 0) {   // Lazy draws use the deal generator
+        u.oldRng = s.rng;
+        u.oldHeldDrawn = (unsigned char)s.drawCounts.heldDrawn();
+    }
+    if (s.drawPileSize() == 0 && s.discardPile.size() > 1) {
+        u.reshuffleAt = u.drawCount;
+        u.oldDrawPile = s.drawPile;
+        u.oldDiscardPile = s.discardPile;
+        if (!s.lazyDeck) u.oldRng = s.reshuffleRng;
+    }
+    s.hands[p].add(s.drawCard());
+    u.drawnBy[u.drawCount++] = (unsigned char)p;
+}
+
+// Plays one turn. Returns the index of the player who won with this
+// move, or -1 if the game goes on.
+int applyMove(GameState &s, Move m, MoveUndo &u) {
+    int player = s.currentPlayer;
+    Hand &hand = s.hands[player];
+
+    u.oldTopCard = s.topCard;
+    u.slot = m.slot;
+    u.player = (unsigned char)player;
+    u.oldCurrentPlayer = (unsigned char)s.currentPlayer;
+    u.oldClockwise = s.isClockwise;
+    u.oldEffectApplied = s.effectApplied;
+    u.drawCount = 0;
+    u.reshuffleAt = -1;
+
+    // ---- playerTurn ----
+    if (m.slot < 0 || m.slot >= hand.size() || !cardFits(hand[m.slot], s.topCard)) {
+        u.slot = -1;   // Drawing, or an invalid choice (which also draws)
+        if (s.canDraw()) drawForUndo(s, player, u);
+    } else {
+        u.played = hand.removeAt(m.slot);
+        s.topCard = u.played;
+        s.discardPile.push(u.played);
+        s.effectApplied = false;
+
+        if (hand.empty()) return player;   // WIN
+
+        // checkUNO
+        if (hand.size() == 1 && !m.callUNO)
+            for (int i = 0; i < 2; i++)
+                if (s.canDraw()) drawForUndo(s, player, u);
+    }
+
+    // ---- applySpecialCard ----
+    CardType type = s.topCard.getType();
+    if (!s.effectApplied && type != NUMBER) {
+        int next = s.nextPlayer(s.currentPlayer);
+        switch (type) {
+            case SKIP:
+                s.currentPlayer = next;
+                break;
+            case REVERSE:
+                if (s.numPlayers == 2) s.currentPlayer = next;
+                else s.isClockwise = !s.isClockwise;
+                break;
+            case DRAW_TWO:
+                for (int i = 0; i < 2; i++)
+                    if (s.canDraw()) drawForUndo(s, next, u);
+                s.currentPlayer = next;
+                break;
+            case WILD_CARD:
+                s.topCard.setColor((Color)m.color);
+                break;
+            case WILD_DRAW_FOUR:
+                for (int i = 0; i < 4; i++)
+                    if (s.canDraw()) drawForUndo(s, next, u);
+                s.topCard.setColor((Color)m.color);
+                s.currentPlayer = next;
+                break;
+            default:
+                break;
+        }
+        s.effectApplied = true;
+    }
+
+    // ---- next player ----
+    s.currentPlayer = s.nextPlayer(s.currentPlayer);
+    return -1;
+}
+
+// Restores the state to exactly what it was before applyMove(s, m, u)
+void undoMove(GameState &s, const MoveUndo &u) {
+    // Put drawn cards back on the draw pile, newest first
+    for (int k = u.drawCount - 1; k >= 0; k--) {
+        Hand &h = s.hands[u.drawnBy[k]];
+        Card c = h.removeAt(h.size() - 1);
+        if (!s.lazyDeck) s.drawPile.pushFront(c);
+        else if (u.reshuffleAt >= 0 && k >= u.reshuffleAt) s.drawCounts.add(c);   // Cleared below
+        else s.drawCounts.putBack(c, u.oldHeldDrawn);
+        if (k == u.reshuffleAt) {
+            s.drawPile = u.oldDrawPile;
+            s.discardPile = u.oldDiscardPile;
+            if (s.lazyDeck) s.drawCounts.clearCounts();   // It was empty before the reshuffle
+            else s.reshuffleRng = u.oldRng;
+        }
+    }
+    if (s.lazyDeck && u.drawCount > 0) s.rng = u.oldRng;
+
+    if (u.slot >= 0) {
+        s.discardPile.pop();
+        s.hands[u.player].insertAt(u.slot, u.played);
+    }
+
+    s.topCard = u.oldTopCard;
+    s.currentPlayer = u.oldCurrentPlayer;
+    s.isClockwise = u.oldClockwise;
+    s.effectApplied = u.oldEffectApplied;
+}
+
+// Game over after applyMove() returned 'winner'? (the player who moved
+// emptied their hand, or nothing can be drawn any more: a draw)
+inline bool isGameOver(const GameState &s, int winner) {
+    return winner >= 0 || !s.canDraw();
+}
+
+// All distinct moves for the player to move: drawing, and every playable
+// card (identical cards only once, wild cards once per color).
+int generateMoves(const GameState &s, Move moves[]) {
+    const Hand &hand = s.hands[s.currentPlayer];
+    MoveMask legal = legalMoves(hand, s.topCard);
+    unsigned long long seen[4] = {0, 0, 0, 0};
+    int n = 0;
+
+    moves[n++] = Move::draw();
+    for (int i = 0; i < hand.size(); i++) {
+        unsigned char code = hand.cards[i].code;
+        if (!legal.test(i) || ((seen[code >> 6] >> (code & 63)) & 1)) continue;
+        seen[code >> 6] |= 1ULL << (code & 63);
+
+        CardType type = hand[i].getType();
+        if (type == WILD_CARD || type == WILD_DRAW_FOUR) {
+            for (int c = RED; c <= YELLOW; c++) moves[n++] = Move::play(i, (Color)c);
+        } else {
+            moves[n++] = Move::play(i);
+        }
+    }
+    return n;
+}
+
+// ======================================================
+//           ZOBRIST HASH / TRANSPOSITION TABLE
+// ======================================================
+// Hash of what a search cares about: every hand, the top card (its code
+// includes the color chosen for a wild), direction, effect flag and the
+// player to move. The hands keep their own part up to date, so this only
+// combines a few numbers and is O(1) after any move or undo.
+// With a seat, only what that player can see is hashed: its own hand and
+// the size of the others, so every determinization of one information
+// set gets the same key.
+unsigned long long hashState(const GameState &s, int seat = -1) {
+    unsigned long long h = 0;
+    for (int p = 0; p < s.numPlayers; p++)
+        h += seat < 0 || p == seat ? s.hands[p].hash : s.hands[p].size() * ZOBRIST.handSize[p];
+    h ^= ZOBRIST.top[s.topCard.code];
+    h ^= ZOBRIST.toMove[s.currentPlayer];
+    if (!s.isClockwise) h ^= ZOBRIST.counterClockwise;
+    if (s.effectApplied) h ^= ZOBRIST.effectApplied;
+    return h;
+}
+
+// What the table remembers about a position (packed into 64 bits)
+struct TTData {
+    float wins;             // Playouts through the position won by 'mover'
+    unsigned short visits;  // Playouts through the position
+    unsigned char mover;    // Player whose move led to the position
+    unsigned char writer;   // Search thread that stored it
+
+    unsigned long long pack() const {
+        unsigned long long d;
+        memcpy(&d, this, sizeof(d));
+        return d;
+    }
+    static TTData unpack(unsigned long long d) {
+        TTData t;
+        memcpy(&t, &d, sizeof(t));
+        return t;
+    }
+};
+static_assert(sizeof(TTData) == 8, "TTData must fit in one 64-bit word");
+
+// Fixed-size hash table shared by all search threads without locks.
+// Each slot stores (key ^ data) and data as two separate atomic words.
+// A reader that sees half of one write and half of another gets a key
+// that does not match, so a torn entry is simply a miss (the "lockless
+// hashing" trick used by chess engines). Size is a power of two and is
+// allocated once, never during search.
+class TranspositionTable {
+private:
+    struct Entry {
+        atomic<unsigned long long> check;   // key ^ data
+        atomic<unsigned long long> data;
+    };
+
+    Entry *entries;
+    unsigned long long mask;
+
+public:
+    explicit TranspositionTable(int log2Entries) {
+        unsigned long long n = 1ULL << log2Entries;
+        entries = new Entry[n];
+        mask = n - 1;
+        clear();
+    }
+    ~TranspositionTable() { delete[] entries; }
+
+    TranspositionTable(const TranspositionTable &) = delete;
+    TranspositionTable &operator=(const TranspositionTable &) = delete;
+
+    unsigned long long size() const { return mask + 1; }
+
+    void clear() {
+        for (unsigned long long i = 0; i <= mask; i++) {
+            entries[i].check.store(0, memory_order_relaxed);
+            entries[i].data.store(0, memory_order_relaxed);
+        }
+    }
+
+    // True and fills 'out' if the position is in the table
+    bool probe(unsigned long long key, TTData &out) const {
+        const Entry &e = entries[key & mask];
+        unsigned long long data = e.data.load(memory_order_relaxed);
+        unsigned long long check = e.check.load(memory_order_relaxed);
+        if ((check ^ data) != key || (check == 0 && data == 0)) return false;
+        out = TTData::unpack(data);
+        return true;
+    }
+
+    // Keeps the result with more playouts when the same position is stored
+    // twice; a different position always replaces the old one
+    void store(unsigned long long key, const TTData &t) {
+        Entry &e = entries[key & mask];
+        unsigned long long old = e.data.load(memory_order_relaxed);
+        unsigned long long oldKey = e.check.load(memory_order_relaxed) ^ old;
+        if (oldKey == key && TTData::unpack(old).visits > t.visits) return;
+
+        unsigned long long data = t.pack();
+        e.data.store(data, memory_order_relaxed);
+        e.check.store(key ^ data, memory_order_relaxed);
+    }
+};
+
+// ======================================================
+//                      ISMCTS BOT
+// ======================================================
+// Information-set Monte Carlo tree search. The bot only knows its own
+// hand, the discard pile and how many cards everyone holds, so every
+// playout starts from a "determinization": the cards it cannot see
+// (other hands + draw pile) are shuffled and dealt out again with the
+// same counts. One tree is shared by all determinizations. A child is
+// identified by the card it plays, not by its slot, so the same node is
+// found whatever deal was sampled. Moves are played with applyMove(),
+// i.e. the same rules as isValidMove/applySpecialCard. Drawing on purpose
+// while holding a playable card is never searched: it is almost always
+// bad and only spreads the playouts thinner.
+// Root parallelism: each thread grows its own tree and the visit counts
+// of the root moves are added up to pick the move. The threads share
+// what they learn below the root through a transposition table keyed by
+// hashState(s, seat): a new node whose information set another thread
+// (or another path) already searched starts from the stored statistics.
+// A node only ever writes back the playouts it ran itself.
+// Root moves never do, so each playout is counted once when voting.
+
+// Search settings (set from the command line)
+struct IsmctsConfig {
+    int playouts;   // Per move, split across the threads
+    int threads;
+};
+IsmctsConfig ismctsConfig = {1000, 1};
+
+const int MAX_SEARCH_THREADS = 64;
+const int MAX_TREE_NODES = 1 << 18;     // Per thread; when full the tree stops growing
+const int MAX_TREE_DEPTH = 64;
+const int MAX_PLAYOUT_MOVES = 2000;     // Safety cap for one random playout
+
+// Throughput counters for the playouts/sec report
+atomic<long long> searchPlayouts(0);
+atomic<long long> searchNanoseconds(0);
+
+// Transposition table counters: new nodes looked up, found, and found in
+// an entry stored by a different search thread
+atomic<long long> tableProbes(0);
+atomic<long long> tableHits(0);
+atomic<long long> tableSharedHits(0);
+
+// Prints playouts/sec if any search ran
+void printSearchReport() {
+    long long playouts = searchPlayouts.load();
+    double seconds = searchNanoseconds.load() / 1e9;
+    if (playouts == 0) return;
+    cout << "Search: " << playouts << " playouts in " << seconds << " s ("
+         << (seconds > 0 ? playouts / seconds : 0.0) << " playouts/sec)\n";
+    long long probes = tableProbes.load();
+    if (probes > 0)
+        cout << "Table: " << tableHits.load() << " of " << probes << " new nodes found ("
+             << 100.0 * tableHits.load() / probes << "%), " << tableSharedHits.load()
+             << " stored by another thread\n";
+}
+
+const unsigned short DRAW_MOVE_KEY = 0xFFFF;
+
+// generateMoves() without the voluntary draw: moves[0] is drawing, so
+// skip it when there is anything else. Returns the first move to use.
+inline int searchMoves(const GameState &s, Move moves[], int &n) {
+    n = generateMoves(s, moves);
+    if (n == 1) return 0;
+    n--;
+    return 1;
+}
+
+// Move key that does not depend on the hand order: the card byte, plus
+// the chosen color for wild cards
+unsigned short moveKey(const Hand &hand, Move m) {
+    if (m.slot < 0) return DRAW_MOVE_KEY;
+    Card c = hand[m.slot];
+    return (unsigned short)(c.code | (c.getColor() == WILD ? m.color << 8 : 0));
+}
+
+// Replaces everything 'seat' cannot see with a random deal of the same cards
+void determinize(GameState &s, int seat, Rng &rng) {
+    Card unseen[DECK_SIZE];
+    int sizes[MAX_PLAYERS];
+    int n = 0;
+
+    for (int p = 0; p < s.numPlayers; p++) {
+        sizes[p] = s.hands[p].size();
+        if (p == seat) continue;
+        for (int i = 0; i < sizes[p]; i++) unseen[n++] = s.hands[p][i];
+    }
+    if (s.lazyDeck) n += s.drawCounts.takeAll(unseen + n);
+    while (!s.drawPile.empty()) unseen[n++] = s.drawPile.popFront();
+
+    shuffleCards(unseen, n, rng);
+
+    int k = 0;
+    for (int p = 0; p < s.numPlayers; p++) {
+        if (p == seat) continue;
+        s.hands[p].clear();
+        for (int i = 0; i < sizes[p]; i++) s.hands[p].add(unseen[k++]);
+    }
+    if (s.lazyDeck) {
+        for (int i = k; i < n; i++) s.drawCounts.add(unseen[i]);
+        s.rng.seed(rng.next());        // Future lazy draws are unknown too
+    } else {
+        s.drawPile.assign(unseen + k, n - k);
+    }
+    s.reshuffleRng.seed(rng.next());   // Future reshuffles are unknown too
+}
+
+// Playout policy: like ColorMajorityBot (a card of the color held most,
+// then other colored cards, wilds last), picking at random among the
+// cards of the best rank. Draws only if nothing can be played.
+Move playoutMove(const GameState &s, Rng &rng) {
+    const Hand &hand = s.hands[s.currentPlayer];
+    MoveMask legal = legalMoves(hand, s.topCard);
+    if (!legal.any()) return Move::draw();
+
+    Color favorite = majorityColor(hand);
+    int best = -1, bestRank = 3, ties = 0;
+    for (int i = 0; i < hand.size(); i++) {
+        if (!legal.test(i)) continue;
+        Color c = hand[i].getColor();
+        int rank = c == favorite ? 0 : (c == WILD ? 2 : 1);
+        if (rank < bestRank) {
+            best = i;
+            bestRank = rank;
+            ties = 1;
+        } else if (rank == bestRank && rng.below((unsigned int)++ties) == 0) {
+            best = i;   // Reservoir sampling keeps a uniform pick among ties
+        }
+    }
+    return Move::play(best, favorite);
+}
+
+struct IsmctsNode {
+    int firstChild;
+    int nextSibling;
+    int visits;
+    int available;         // How often this move was legal when its parent was visited
+    float wins;            // Wins of the player who made the move
+    int seedVisits;        // Part of visits/wins copied from the table,
+    float seedWins;        // i.e. not played by this tree
+    unsigned short key;
+    unsigned char mover;
+};
+
+// One search tree with a node pool that is allocated once and reused
+class IsmctsTree {
+private:
+    vector<IsmctsNode> nodes;
+    int used;
+    Rng rng;
+    TranspositionTable *table;   // Shared with the other trees, or NULL
+    int id;                      // This tree's index among the search threads
+    long long probes, hits, sharedHits;
+
+    int newNode(unsigned short key, int mover) {
+        IsmctsNode &n = nodes[used];
+        n.firstChild = -1;
+        n.nextSibling = -1;
+        n.visits = 0;
+        n.available = 0;
+        n.wins = 0;
+        n.seedVisits = 0;
+        n.seedWins = 0;
+        n.key = key;
+        n.mover = (unsigned char)mover;
+        return used++;
+    }
+
+    // Starts a new node from the table entry for its position, if any
+    void lookUp(int node, unsigned long long key) {
+        TTData t;
+        probes++;
+        if (!table->probe(key, t) || t.mover != nodes[node].mover) return;
+        hits++;
+        sharedHits += t.writer != id;
+        nodes[node].visits = nodes[node].seedVisits = t.visits;
+        nodes[node].wins = nodes[node].seedWins = t.wins;
+    }
+
+    // Stores only this tree's own playouts through the node: the seeded
+    // part is already in the table (or was replaced there), and storing
+    // it again would count the other thread's playouts twice
+    void remember(int node, unsigned long long key) {
+        const IsmctsNode &n = nodes[node];
+        int own = n.visits - n.seedVisits;
+        if (own <= 0) return;
+        TTData t;
+        t.visits = (unsigned short)min(own, 0xFFFF);   // Scale down rather than wrap
+        t.wins = (n.wins - n.seedWins) * t.visits / own;
+        t.mover = n.mover;
+        t.writer = (unsigned char)id;
+        table->store(key, t);
+    }
+
+public:
+    IsmctsTree() : used(0), table(NULL), id(0), probes(0), hits(0), sharedHits(0) {}
+
+    void init(int capacity, unsigned long long seed, TranspositionTable *shared = NULL, int index = 0) {
+        if ((int)nodes.size() != capacity) nodes.resize(capacity);
+        rng.seed(seed);
+        table = shared;
+        id = index;
+    }
+
+    // Adds this tree's table counters to the report and clears them
+    void reportTable() {
+        tableProbes += probes;
+        tableHits += hits;
+        tableSharedHits += sharedHits;
+        probes = hits = sharedHits = 0;
+    }
+
+    // Child of 'parent' for move 'key', or -1
+    int findChild(int parent, unsigned short key) const {
+        for (int c = nodes[parent].firstChild; c >= 0; c = nodes[c].nextSibling)
+            if (nodes[c].key == key) return c;
+        return -1;
+    }
+
+    int rootVisits(unsigned short key) const {
+        int c = findChild(0, key);
+        return c < 0 ? 0 : nodes[c].visits;
+    }
+
+    // Runs 'playouts' iterations from 'root' for the player to move
+    void search(const GameState &root, int playouts) {
+        int seat = root.currentPlayer;
+        used = 0;
+        newNode(DRAW_MOVE_KEY, seat);
+
+        Move moves[MAX_MOVES];
+        int untried[MAX_MOVES];
+        int path[MAX_TREE_DEPTH + 1];
+        unsigned long long keys[MAX_TREE_DEPTH + 1];   // Table key of each node on the path
+        MoveUndo undo;   // Not used for undoing, applyMove just needs somewhere to write
+
+        for (int it = 0; it < playouts; it++) {
+            GameState s = root;
+            determinize(s, seat, rng);
+
+            int node = 0, depth = 0, winner = -1;
+            path[depth++] = 0;
+
+            // Selection and expansion
+            while (!isGameOver(s, winner) && depth <= MAX_TREE_DEPTH) {
+                const Hand &hand = s.hands[s.currentPlayer];
+                int n;
+                Move *list = moves + searchMoves(s, moves, n);
+                int numUntried = 0, best = -1, bestMove = -1;
+                double bestScore = -1;
+
+                for (int i = 0; i < n; i++) {
+                    int c = findChild(node, moveKey(hand, list[i]));
+                    if (c < 0) {
+                        untried[numUntried++] = i;
+                        continue;
+                    }
+                    IsmctsNode &child = nodes[c];
+                    child.available++;
+                    double score = child.wins / child.visits +
+                                   0.7 * sqrt(log((double)child.available) / child.visits);
+                    if (score > bestScore) {
+                        bestScore = score;
+                        best = c;
+                        bestMove = i;
+                    }
+                }
+
+                int mover = s.currentPlayer;
+                if (numUntried > 0 && used < (int)nodes.size()) {
+                    // Expand one move that has no node yet, then go to the playout
+                    int i = untried[rng.below((unsigned int)numUntried)];
+                    int c = newNode(moveKey(hand, list[i]), mover);
+                    nodes[c].available = 1;
+                    nodes[c].nextSibling = nodes[node].firstChild;
+                    nodes[node].firstChild = c;
+                    winner = applyMove(s, list[i], undo);
+                    if (table) {
+                        keys[depth] = hashState(s, seat);
+                        if (depth > 1) lookUp(c, keys[depth]);
+                    }
+                    path[depth++] = c;
+                    break;
+                }
+                if (best < 0) break;   // Pool full and nothing to follow
+
+                winner = applyMove(s, list[bestMove], undo);
+                node = best;
+                if (table) keys[depth] = hashState(s, seat);
+                path[depth++] = node;
+            }
+
+            // Random playout to the end of the game
+            for (int m = 0; !isGameOver(s, winner) && m < MAX_PLAYOUT_MOVES; m++)
+                winner = applyMove(s, playoutMove(s, rng), undo);
+
+            // Backpropagation
+            for (int d = 0; d < depth; d++) {
+                IsmctsNode &n = nodes[path[d]];
+                n.visits++;
+                if (winner == n.mover) n.wins += 1;
+                if (table && d > 1) remember(path[d], keys[d]);
+            }
+        }
+    }
+};
+
+class IsmctsBot final : public PlayerPolicy {
+private:
+    const GameState *game;
+    Rng rng;
+    vector<IsmctsTree> trees;   // One per search thread, kept between moves
+    unique_ptr<TranspositionTable> table;   // Shared by the trees, kept between moves
+    Color pendingColor;
+
+public:
+    IsmctsBot() : game(NULL), pendingColor(RED) {}
+
+    // Copies start without trees or table; they are rebuilt on first use
+    IsmctsBot(const IsmctsBot &other) : game(other.game), rng(other.rng), pendingColor(RED) {}
+
+    void setup(int seat, unsigned long long seed) { rng.seed(seed * 31 + seat); }
+    void attach(const GameState *state) { game = state; }
+
+    const char *botName() const { return "ismcts"; }
+
+    // Best move for the player to move in 'root'
+    Move search(const GameState &root) {
+        Move moves[MAX_MOVES];
+        int n;
+        Move *list = moves + searchMoves(root, moves, n);
+        if (n == 1) return list[0];   // Only one choice (possibly drawing)
+
+        int threads = max(1, min(ismctsConfig.threads, MAX_SEARCH_THREADS));
+        int perThread = max(1, (ismctsConfig.playouts + threads - 1) / threads);
+        if ((int)trees.size() != threads) trees.resize(threads);
+
+        // About four entries per playout of one search, 16 bytes each
+        int log2Entries = 10;
+        while (log2Entries < 20 && (1LL << log2Entries) < 4LL * perThread * threads) log2Entries++;
+        if (!table || (long long)table->size() != 1LL << log2Entries)
+            table.reset(new TranspositionTable(log2Entries));
+
+        for (int t = 0; t < threads; t++)
+            trees[t].init(min(perThread + 1, MAX_TREE_NODES), rng.next(), table.get(), t);
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        if (threads == 1) {
+            trees[0].search(root, perThread);
+        } else {
+            thread workers[MAX_SEARCH_THREADS];
+            for (int t = 0; t < threads; t++)
+                workers[t] = thread(&IsmctsTree::search, &trees[t], cref(root), perThread);
+            for (int t = 0; t < threads; t++) workers[t].join();
+        }
+        for (int t = 0; t < threads; t++) trees[t].reportTable();
+        searchPlayouts += (long long)perThread * threads;
+        searchNanoseconds += chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now() - start).count();
+
+        // Merge the root visit counts of all trees
+        const Hand &hand = root.hands[root.currentPlayer];
+        int best = 0, bestVisits = -1;
+        for (int i = 0; i < n; i++) {
+            unsigned short key = moveKey(hand, list[i]);
+            int visits = 0;
+            for (int t = 0; t < threads; t++) visits += trees[t].rootVisits(key);
+            if (visits > bestVisits) {
+                bestVisits = visits;
+                best = i;
+            }
+        }
+        return list[best];
+    }
+
+    int chooseCard(const Hand &hand, Card topCard) {
+        if (game == NULL) return FirstPlayableBot().chooseCard(hand, topCard);
+        Move m = search(*game);
+        pendingColor = (Color)m.color;
+        return m.slot + 1;
+    }
+
+    Color chooseColor(const Hand &hand) {
+        return game == NULL ? majorityColor(hand) : pendingColor;
+    }
+
+    bool callUNO() { return true; }
+};
+
+// Calls fn(Bot()) with the bot type named on the command line
+// ("mixed" seats the built-in bots round-robin). False if unknown.
+template <class Fn>
+bool withBotType(const string &name, Fn fn) {
+    if (name == "first")  { fn(FirstPlayableBot()); return true; }
+    if (name == "random") { fn(RandomBot()); return true; }
+    if (name == "greedy") { fn(GreedyBot()); return true; }
+    if (name == "color")  { fn(ColorMajorityBot()); return true; }
+    if (name == "mixed")  { fn(BotByKind()); return true; }
+    if (name == "ismcts") { fn(IsmctsBot()); return true; }
+    if (name == "count")  { fn(CardCountingBot()); return true; }
+    return false;
+}
+
+// ======================================================
+//                 HEADLESS SIMULATION
+// ======================================================
+// One complete set of game modules, bots and hands. Each simulation
+// thread owns its own engine, so nothing is shared while games run.
+// Bot is the policy class used for every seat, Rules the house rules.
+template <class Bot, class Rules = StandardRules>
+struct GameEngine {
+    GameState state;
+    DeckManagement module1;
+    PlayerManagement module2;
+    GameRulesT<Rules> module3;
+    GameConfig config;
+
+    Bot bots[MAX_PLAYERS];
+    Bot *policies[MAX_PLAYERS];
+    CardTracker tracker;   // Only kept up to date for bots that count cards
+
+    GameEngine(int numPlayers, int cardsPerPlayer, unsigned long long seed)
+        : module1(state), module3(state) {
+        module1.setQuiet(true);
+        module2.setQuiet(true);
+        module3.setQuiet(true);
+        module1.seedShuffle(seed);
+
+        config.numPlayers = numPlayers;
+        config.cardsPerPlayer = cardsPerPlayer;
+        config.lazyDeck = lazyDeckMode;
+        for (int i = 0; i < numPlayers; i++) {
+            stringstream ss; ss << "Bot " << i + 1;
+            config.playerNames[i] = ss.str();
+        }
+        module1.setGameConfiguration(config);
+
+        for (int i = 0; i < MAX_PLAYERS; i++) {
+            bots[i].setup(i, seed);
+            bots[i].attach(&state);
+            policies[i] = &bots[i];
+        }
+        if (Bot::usesCardTracker) {
+            module1.setCardTracker(&tracker);
+            module2.setCardTracker(&tracker);
+            module3.setCardTracker(&tracker);
+            for (int i = 0; i < MAX_PLAYERS; i++) bots[i].attachTracker(&tracker);
+        }
+    }
+
+    // Use the random streams of game number 'game' (deal, reshuffles, bots)
+    void seedGame(const RngStreams &streams, unsigned long long game) {
+        module1.seedStreams(streams, game);
+        unsigned long long botSeed = streams.seed(game, STREAM_BOT);
+        for (int i = 0; i < config.numPlayers; i++) bots[i].setup(i, botSeed);
+    }
+
+    // Record all following games in 'log' (NULL = stop)
+    void setEventLog(EventLog *log) {
+        module1.setEventLog(log);
+        module2.setEventLog(log);
+        module3.setEventLog(log);
+    }
+
+    // Shuffle, deal and turn up the first card
+    void deal() {
+        module1.createDeck();
+        module1.dealCards();
+        module1.setTopCard();
+        module3.reset();
+    }
+
+    // Play the dealt game to the end. Returns winner or -1 (draw).
+    int play() { return runGame(module1, module2, module3, policies, true); }
+
+    // Deal a fresh game and play it to the end. Returns winner or -1 (draw).
+    int playGame() {
+        deal();
+        return play();
+    }
+
+    // What the winner of the game just played scores: the points left in
+    // all other hands
+    int roundPoints(int winner) const {
+        int points = 0;
+        for (int p = 0; p < config.numPlayers; p++)
+            if (p != winner) points += state.hands[p].bits.points();
+        return points;
+    }
+};
+
+// Win/draw counters for a batch of games
+struct GameStats {
+    long long wins[MAX_PLAYERS];
+    long long draws;
+
+    GameStats() : draws(0) {
+        for (int i = 0; i < MAX_PLAYERS; i++) wins[i] = 0;
+    }
+
+    void record(int winner) {
+        if (winner < 0) draws++;
+        else wins[winner]++;
+    }
+};
+
+// Prints the result of a simulation run
+template <class Bot, class Rules = StandardRules>
+void printSimulationReport(const GameStats &stats, long long games, int numPlayers,
+                           int cardsPerPlayer, double seconds) {
+    cout << "Simulated " << games << " games (" << numPlayers << " players, "
+         << cardsPerPlayer << " cards each) in " << seconds << " s\n";
+    if (!is_same<Rules, StandardRules>::value) cout << "Rules: " << Rules::name << "\n";
+    cout << "Games per second: " << (seconds > 0 ? games / seconds : 0.0) << "\n";
+    for (int i = 0; i < numPlayers; i++) {
+        Bot bot;
+        bot.setup(i, 0);
+        cout << "Bot " << i + 1 << " (" << bot.botName() << ") wins: " << stats.wins[i] << "\n";
+    }
+    cout << "Draws: " << stats.draws << "\n";
+    printSearchReport();
+}
+
+// Plays many bot-only games with no console I/O and reports games/sec.
+// With an event log every game is recorded in it. Game g uses the
+// random streams of game g, so the farm gets the same results.
+template <class Bot, class Rules = StandardRules>
+void runSimulation(long long games, int numPlayers, int cardsPerPlayer,
+                   unsigned long long seed, EventLog *events = NULL) {
+    GameEngine<Bot, Rules> engine(numPlayers, cardsPerPlayer, seed);
+    engine.setEventLog(events);
+    RngStreams streams(seed);
+    GameStats stats;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    for (long long g = 0; g < games; g++) {
+        engine.seedGame(streams, g);
+        stats.record(engine.playGame());
+    }
+
+    if (events) events->flush();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Seed: " << seed << "\n";
+    printSimulationReport<Bot, Rules>(stats, games, numPlayers, cardsPerPlayer, seconds);
+    if (events) cout << "Logged " << events->bytes() << " bytes ("
+                     << (double)events->bytes() / games << " per game)\n";
+}
+
+// ======================================================
+//                     MATCH MODE
+// ======================================================
+// A match is played in rounds to MATCH_TARGET points. The winner of a
+// round scores the points left in the other hands (face value, 20 per
+// action card, 50 per wild card); a drawn round scores nothing. The
+// player who starts moves one seat on every round.
+// Every round is dealt into the engine's GameState again (the deck is
+// copied back into the fixed piles), and the hands' per-kind counts give
+// their points without a scan (HandBits::points), so a round of a match
+// costs the same as a single game and allocates nothing.
+const int MATCH_TARGET = 500;
+const int MAX_MATCH_ROUNDS = 1000;   // Then the highest score wins
+
+struct MatchResult {
+    int winner;
+    int rounds;
+    int score[MAX_PLAYERS];
+};
+
+// Deal round 'round' of a match and play it out. Returns the round's
+// winner or -1 (draw), with their points added to 'result'.
+template <class Bot, class Rules>
+int playMatchRound(GameEngine<Bot, Rules> &engine, const RngStreams &streams,
+                   unsigned long long match, int round, MatchResult &result) {
+    engine.seedGame(streams, (match << 32) | (unsigned)round);
+    engine.deal();
+    engine.state.currentPlayer = round % engine.config.numPlayers;
+    int winner = engine.play();
+    if (winner >= 0) result.score[winner] += engine.roundPoints(winner);
+    result.rounds = round + 1;
+    return winner;
+}
+
+// Play match number 'match' until someone reaches 'target' points
+template <class Bot, class Rules>
+MatchResult playMatch(GameEngine<Bot, Rules> &engine, const RngStreams &streams,
+                      unsigned long long match, int target = MATCH_TARGET) {
+    MatchResult result;
+    result.winner = -1;
+    result.rounds = 0;
+    for (int p = 0; p < MAX_PLAYERS; p++) result.score[p] = 0;
+
+    for (int round = 0; round < MAX_MATCH_ROUNDS; round++) {
+        int winner = playMatchRound(engine, streams, match, round, result);
+        if (winner >= 0 && result.score[winner] >= target) {
+            result.winner = winner;
+            return result;
+        }
+    }
+    result.winner = 0;
+    for (int p = 1; p < engine.config.numPlayers; p++)
+        if (result.score[p] > result.score[result.winner]) result.winner = p;
+    return result;
+}
+
+// Plays many bot-only matches and reports match wins, rounds and scores
+template <class Bot, class Rules = StandardRules>
+void runMatches(long long matches, int numPlayers, int cardsPerPlayer,
+                unsigned long long seed, int target) {
+    GameEngine<Bot, Rules> engine(numPlayers, cardsPerPlayer, seed);
+    RngStreams streams(seed);
+    long long wins[MAX_PLAYERS] = {0}, rounds = 0, winnerPoints = 0;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    for (long long m = 0; m < matches; m++) {
+        MatchResult result = playMatch(engine, streams, m, target);
+        wins[result.winner]++;
+        rounds += result.rounds;
+        winnerPoints += result.score[result.winner];
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Seed: " << seed << "\n";
+    cout << "Played " << matches << " matches to " << target << " points (" << numPlayers
+         << " players, " << cardsPerPlayer << " cards each) in " << seconds << " s\n";
+    if (!is_same<Rules, StandardRules>::value) cout << "Rules: " << Rules::name << "\n";
+    cout << "Rounds per second: " << (seconds > 0 ? rounds / seconds : 0.0) << "\n";
+    cout << "Rounds per match: " << (double)rounds / matches << "\n";
+    cout << "Winner's final score: " << (double)winnerPoints / matches << "\n";
+    for (int i = 0; i < numPlayers; i++) {
+        Bot bot;
+        bot.setup(i, 0);
+        cout << "Bot " << i + 1 << " (" << bot.botName() << ") matches won: " << wins[i] << "\n";
+    }
+    printSearchReport();
+}
+
+// ======================================================
+//                     GAME FARM
+// ======================================================
+// Range of game numbers [begin, end) owned by one worker. Both ends are
+// packed into one 64-bit atomic so the owner (taking small chunks from
+// the front) and thieves (taking half from the back) only need a CAS.
+struct alignas(64) WorkRange {
+    atomic<unsigned long long> range;
+
+    WorkRange() : range(0) {}
+
+    static unsigned long long pack(unsigned begin, unsigned end) {
+        return ((unsigned long long)begin << 32) | end;
+    }
+
+    void set(unsigned begin, unsigned end) { range.store(pack(begin, end)); }
+
+    // Owner: take up to 'chunk' games from the front
+    bool take(unsigned chunk, unsigned &begin, unsigned &end) {
+        unsigned long long r = range.load();
+        while (true) {
+            unsigned b = (unsigned)(r >> 32), e = (unsigned)r;
+            if (b >= e) return false;
+            unsigned nb = (e - b > chunk) ? b + chunk : e;
+            if (range.compare_exchange_weak(r, pack(nb, e))) {
+                begin = b;
+                end = nb;
+                return true;
+            }
+        }
+    }
+
+    // Thief: take the back half of the remaining games
+    bool steal(unsigned &begin, unsigned &end) {
+        unsigned long long r = range.load();
+        while (true) {
+            unsigned b = (unsigned)(r >> 32), e = (unsigned)r;
+            if (b >= e) return false;
+            unsigned half = (e - b + 1) / 2;
+            if (range.compare_exchange_weak(r, pack(b, e - half))) {
+                begin = e - half;
+                end = e;
+                return true;
+            }
+        }
+    }
+};
+
+// Worker loop: play own games, then steal from the others until all are
+// done. Worker is anything with playGame(unsigned g).
+template <class Worker>
+void farmWorker(int id, int numWorkers, WorkRange ranges[], Worker *worker) {
+    const unsigned CHUNK = 16;
+    while (true) {
+        unsigned begin, end;
+        if (ranges[id].take(CHUNK, begin, end)) {
+            for (unsigned g = begin; g < end; g++) worker->playGame(g);
+            continue;
+        }
+
+        // Own range is empty: try to steal from someone else
+        bool stolen = false;
+        for (int k = 1; k < numWorkers && !stolen; k++) {
+            int victim = (id + k) % numWorkers;
+            if (ranges[victim].steal(begin, end)) {
+                ranges[id].set(begin, end);
+                stolen = true;
+            }
+        }
+        if (!stolen) break;   // Nothing left anywhere
+    }
+}
+
+// Plays games [begin, end) on one thread per worker. Each worker keeps
+// its own results; the caller merges them after this returns.
+template <class Worker>
+void runOnFarm(unsigned begin, unsigned end, Worker *workers[], int numWorkers) {
+    vector<WorkRange> ranges(numWorkers);
+    unsigned long long n = end - begin;
+    for (int t = 0; t < numWorkers; t++)
+        ranges[t].set(begin + (unsigned)(n * t / numWorkers), begin + (unsigned)(n * (t + 1) / numWorkers));
+
+    vector<thread> threads;
+    for (int t = 0; t < numWorkers; t++)
+        threads.push_back(thread(farmWorker<Worker>, t, numWorkers, ranges.data(), workers[t]));
+    for (int t = 0; t < numWorkers; t++) threads[t].join();
+}
+
+// One engine and its win counts. Game g always uses the streams of game
+// g, so which worker plays it does not matter: the totals are the same
+// for any number of threads.
+template <class Bot, class Rules = StandardRules>
+struct FarmGames {
+    GameEngine<Bot, Rules> engine;
+    const RngStreams &streams;
+    GameStats stats;
+
+    FarmGames(int numPlayers, int cardsPerPlayer, const RngStreams &s)
+        : engine(numPlayers, cardsPerPlayer, s.seed()), streams(s) {}
+
+    void playGame(unsigned g) {
+        engine.seedGame(streams, g);
+        stats.record(engine.playGame());
+    }
+};
+
+// Runs independent games on all cores, one engine per thread
+template <class Bot, class Rules = StandardRules>
+void runFarm(long long games, int numPlayers, int cardsPerPlayer, int numThreads,
+             unsigned long long seed) {
+    RngStreams streams(seed);
+    vector<FarmGames<Bot, Rules> *> workers(numThreads);
+    for (int t = 0; t < numThreads; t++)
+        workers[t] = new FarmGames<Bot, Rules>(numPlayers, cardsPerPlayer, streams);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    runOnFarm(0, (unsigned)games, workers.data(), numThreads);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    GameStats stats;
+    for (int t = 0; t < numThreads; t++) {
+        for (int i = 0; i < MAX_PLAYERS; i++) stats.wins[i] += workers[t]->stats.wins[i];
+        stats.draws += workers[t]->stats.draws;
+        delete workers[t];
+    }
+
+    cout << "Threads: " << numThreads << ", seed: " << seed << "\n";
+    printSimulationReport<Bot, Rules>(stats, games, numPlayers, cardsPerPlayer, seconds);
+}
+
+// --search: searches the opening position on several threads and checks
+// that the shared table works: every determinization of the position has
+// the searcher's key, and the threads find entries stored by each other
+int runSearchCheck(int numPlayers, int cardsPerPlayer, unsigned long long seed) {
+    GameEngine<FirstPlayableBot> engine(numPlayers, cardsPerPlayer, seed);
+    engine.module1.createDeck();
+    engine.module1.dealCards();
+    engine.module1.setTopCard();
+    engine.module3.reset();
+    const GameState &root = engine.state;
+
+    Rng rng(seed);
+    int seat = root.currentPlayer, badKeys = 0;
+    for (int i = 0; i < 1000; i++) {
+        GameState s = root;
+        determinize(s, seat, rng);
+        badKeys += hashState(s, seat) != hashState(root, seat);
+    }
+    cout << "Determinizations with a different key: " << badKeys << " of 1000\n";
+
+    IsmctsBot bot;
+    bot.setup(seat, seed);
+    Move m = bot.search(root);
+    cout << "Chosen move: " << (m.slot < 0 ? string("draw") : root.hands[seat][m.slot].toString()) << "\n";
+    printSearchReport();
+
+    bool shared = ismctsConfig.threads < 2 || tableSharedHits.load() > 0;
+    if (!shared) cout << "No thread found an entry stored by another thread\n";
+    return badKeys == 0 && shared ? 0 : 1;
+}
+
+// ======================================================
+//                     TOURNAMENT
+// ======================================================
+// Round robin between built-in bots. A pairing is played as game pairs:
+// the same deal twice with the seats swapped, so neither bot profits from
+// better cards or from seat 0 (who always moves first). With more than
+// two players the seats alternate between the bots.
+// Each pairing runs on the farm in batches under two sequential
+// probability ratio tests (SPRT), one per bot: H0 "equally strong"
+// (0 Elo) against H1 "this bot is 'eloBound' Elo stronger". The pairing
+// stops when one test accepts its H1 (that bot is stronger), when both
+// accept H0 (no difference of 'eloBound' or more), or at the game limit,
+// which is reported as inconclusive. A test that has decided stays
+// decided. The ratings of all bots are refitted after every batch.
+
+const int TOURNAMENT_BATCH = 256;                  // Game pairs between SPRT checks
+const double SPRT_ALPHA = 0.05, SPRT_BETA = 0.05;  // Error rates of the test
+
+// Elo difference that gives expected score s (0 < s < 1), and back
+double eloFromScore(double s) { return 400.0 * log10(s / (1.0 - s)); }
+double scoreFromElo(double elo) { return 1.0 / (1.0 + pow(10.0, -elo / 400.0)); }
+
+// Results of bot A against bot B. pairs[k] = game pairs in which A
+// scored k half points (0 = lost both games ... 4 = won both).
+struct PairingStats {
+    long long pairs[5];
+
+    PairingStats() {
+        for (int k = 0; k < 5; k++) pairs[k] = 0;
+    }
+
+    void merge(const PairingStats &o) {
+        for (int k = 0; k < 5; k++) pairs[k] += o.pairs[k];
+    }
+
+    long long numPairs() const {
+        long long n = 0;
+        for (int k = 0; k < 5; k++) n += pairs[k];
+        return n;
+    }
+
+    // A's mean score per game (draw = half)
+    double score() const {
+        long long n = numPairs(), half = 0;
+        for (int k = 0; k < 5; k++) half += k * pairs[k];
+        return n > 0 ? half / (4.0 * n) : 0.5;
+    }
+
+    // Variance of one pair's score. Pairs, not games, are the samples,
+    // since the two games of a pair share a deal.
+    double variance() const {
+        long long n = numPairs();
+        if (n == 0) return 0;
+        double mean = score(), v = 0;
+        for (int k = 0; k < 5; k++) v += pairs[k] * (k / 4.0 - mean) * (k / 4.0 - mean);
+        return v / n;
+    }
+
+    // Log-likelihood ratio of "A is elo1 stronger" against "A is elo0
+    // stronger" (normal approximation of the generalized SPRT)
+    double llr(double elo0, double elo1) const {
+        long long n = numPairs();
+        if (n == 0) return 0;
+        double s0 = scoreFromElo(elo0), s1 = scoreFromElo(elo1);
+        double v = max(variance(), 1e-6);
+        return n * (s1 - s0) * (2 * score() - s0 - s1) / (2 * v);
+    }
+
+    // Half width of the 95% interval of the score
+    double margin() const {
+        long long n = numPairs();
+        return n > 0 ? 1.96 * sqrt(variance() / n) : 0.5;
+    }
+};
+
+// One engine playing one pairing (bot kinds a and b) on the farm
+struct TournamentGames {
+    GameEngine<BotByKind> engine;
+    const RngStreams &streams;
+    BotKind a, b;
+    unsigned long long pairing;   // Keeps the deals of different pairings apart
+    PairingStats stats;
+
+    TournamentGames(int numPlayers, int cardsPerPlayer, const RngStreams &s)
+        : engine(numPlayers, cardsPerPlayer, s.seed()), streams(s), a(FIRST_BOT), b(FIRST_BOT),
+          pairing(0) {}
+
+    // Plays one game, seat s gets bot a when s + swapped is even.
+    // Returns 2 if a won, 0 if b won, 1 for a draw.
+    int playOne(unsigned long long game, int swapped) {
+        engine.seedGame(streams, game);
+        for (int s = 0; s < engine.config.numPlayers; s++)
+            engine.bots[s].setKind(((s + swapped) & 1) ? b : a);
+        int w = engine.playGame();
+        if (w < 0) return 1;
+        return ((w + swapped) & 1) ? 0 : 2;
+    }
+
+    void playGame(unsigned pair) {
+        unsigned long long game = (pairing << 32) | pair;
+        stats.pairs[playOne(game, 0) + playOne(game, 1)]++;
+    }
+};
+
+// Bradley-Terry fit of all results so far (minorization-maximization).
+// points[i][j] = points i scored against j, games[i][j] = games played.
+// One virtual draw per pairing keeps a bot that never scored finite.
+// Ratings are Elo with the mean at 0.
+void fitRatings(int n, const vector<vector<double> > &points,
+                const vector<vector<double> > &games, vector<double> &elo) {
+    vector<double> gamma(n, 1.0);
+    for (int iter = 0; iter < 200; iter++) {
+        for (int i = 0; i < n; i++) {
+            double won = 0, sum = 0;
+            for (int j = 0; j < n; j++) {
+                if (j == i || games[i][j] == 0) continue;
+                won += points[i][j] + 0.5;
+                sum += (games[i][j] + 1) / (gamma[i] + gamma[j]);
+            }
+            if (sum > 0) gamma[i] = won / sum;
+        }
+        double logMean = 0;
+        for (int i = 0; i < n; i++) logMean += log(gamma[i]) / n;
+        for (int i = 0; i < n; i++) gamma[i] /= exp(logMean);
+    }
+    elo.resize(n);
+    for (int i = 0; i < n; i++) elo[i] = 400.0 * log10(gamma[i]);
+}
+
+// Outcome of one of the two tests of a pairing
+enum SprtState { SPRT_RUNNING, SPRT_H0, SPRT_H1 };
+
+SprtState sprtUpdate(SprtState state, double llr, double lower, double upper) {
+    if (state != SPRT_RUNNING) return state;
+    if (llr >= upper) return SPRT_H1;
+    if (llr <= lower) return SPRT_H0;
+    return SPRT_RUNNING;
+}
+
+void runTournament(const vector<BotKind> &kinds, long long maxGames, int numPlayers,
+                   int cardsPerPlayer, int numThreads, unsigned long long seed, double eloBound) {
+    int n = (int)kinds.size();
+    RngStreams streams(seed);
+    vector<TournamentGames *> workers(numThreads);
+    for (int t = 0; t < numThreads; t++)
+        workers[t] = new TournamentGames(numPlayers, cardsPerPlayer, streams);
+
+    vector<string> names(n);
+    for (int i = 0; i < n; i++) {
+        BotByKind bot;
+        bot.setKind(kinds[i]);
+        names[i] = bot.botName();
+    }
+
+    vector<vector<double> > points(n, vector<double>(n, 0)), games(n, vector<double>(n, 0));
+    vector<double> elo(n, 0);
+    double lower = log(SPRT_BETA / (1 - SPRT_ALPHA)), upper = log((1 - SPRT_BETA) / SPRT_ALPHA);
+    long long maxPairs = max(1LL, maxGames / 2), totalGames = 0;
+    int numPairings = 0;
+
+    cout << "Tournament: " << n << " bots, " << numPlayers << " players, " << cardsPerPlayer
+         << " cards each, up to " << maxPairs * 2 << " games per pairing, SPRT 0 vs "
+         << eloBound << " Elo each way, seed " << seed << "\n";
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    for (int i = 0; i < n; i++)
+        for (int j = i + 1; j < n; j++) {
+            for (int t = 0; t < numThreads; t++) {
+                workers[t]->a = kinds[i];
+                workers[t]->b = kinds[j];
+                workers[t]->pairing = numPairings;
+                workers[t]->stats = PairingStats();
+            }
+            numPairings++;
+
+            // Play batches until the tests decide or the limit is reached.
+            // Test A: is bot i eloBound stronger? Test B: is bot j?
+            PairingStats result;
+            double llrA = 0, llrB = 0;
+            SprtState testA = SPRT_RUNNING, testB = SPRT_RUNNING;
+            long long played = 0;
+            while (played < maxPairs && testA != SPRT_H1 && testB != SPRT_H1 &&
+                   !(testA == SPRT_H0 && testB == SPRT_H0)) {
+                long long batch = min((long long)TOURNAMENT_BATCH, maxPairs - played);
+                runOnFarm((unsigned)played, (unsigned)(played + batch), workers.data(), numThreads);
+                played += batch;
+
+                result = PairingStats();
+                for (int t = 0; t < numThreads; t++) result.merge(workers[t]->stats);
+                llrA = result.llr(0, eloBound);
+                llrB = result.llr(0, -eloBound);
+                testA = sprtUpdate(testA, llrA, lower, upper);
+                testB = sprtUpdate(testB, llrB, lower, upper);
+
+                points[i][j] = 2.0 * result.numPairs() * result.score();
+                points[j][i] = 2.0 * result.numPairs() - points[i][j];
+                games[i][j] = games[j][i] = 2.0 * result.numPairs();
+                fitRatings(n, points, games, elo);
+            }
+            totalGames += 2 * played;
+
+            double sc = result.score(), m = result.margin();
+            cout << names[i] << " vs " << names[j] << ": " << 2 * played << " games, score "
+                 << 100 * sc << "%, Elo " << eloFromScore(min(max(sc, 1e-4), 1 - 1e-4))
+                 << " [" << eloFromScore(min(max(sc - m, 1e-4), 1 - 1e-4)) << ", "
+                 << eloFromScore(min(max(sc + m, 1e-4), 1 - 1e-4)) << "], LLR " << llrA << " / "
+                 << llrB << " -> ";
+            if (testA == SPRT_H1) cout << names[i] << " stronger\n";
+            else if (testB == SPRT_H1) cout << names[j] << " stronger\n";
+            else if (testA == SPRT_H0 && testB == SPRT_H0)
+                cout << "no difference of " << eloBound << " Elo\n";
+            else cout << "inconclusive\n";
+        }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    for (int t = 0; t < numThreads; t++) delete workers[t];
+
+    cout << "Played " << totalGames << " games in " << seconds << " s (fixed length would be "
+         << 2 * maxPairs * numPairings << ")\n";
+    vector<int> order(n);
+    for (int i = 0; i < n; i++) order[i] = i;
+    sort(order.begin(), order.end(), [&](int x, int y) { return elo[x] > elo[y]; });
+    cout << "Ratings:\n";
+    for (int r = 0; r < n; r++)
+        cout << "  " << r + 1 << ". " << names[order[r]] << "  " << elo[order[r]] << "\n";
+}
+
+// ======================================================
+//                     REPLAY TOOL
+// ======================================================
+// Rebuilds games from an event log. Each game is dealt again from the
+// logged generator state, then every turn is replayed with applyMove()
+// from the logged decisions (card played, color chosen, UNO called or
+// not). The cards the log says were drawn are checked against the cards
+// the replay draws, so a log that does not match the rules is reported.
+
+// Events of one game inside the log file
+struct LoggedGame {
+    int numPlayers;
+    int cardsPerPlayer;
+    bool lazyDeck;
+    Rng rng, reshuffleRng;
+    const unsigned char *events;   // 2 bytes each, up to and including GAME_END
+    int numEvents;
+};
+
+// Splits the file contents into games. False if it is not an event log.
+bool parseEventLog(const vector<unsigned char> &bytes, vector<LoggedGame> &games) {
+    if (bytes.size() < 16 || memcmp(&bytes[0], EVENT_LOG_MAGIC, 8) != 0) return false;
+
+    size_t pos = 16;
+    while (pos + 2 + 2 * sizeof(Rng) <= bytes.size()) {
+        if ((bytes[pos] >> 4) != EV_GAME_START) return false;
+        LoggedGame g;
+        g.numPlayers = bytes[pos] & 15;
+        g.cardsPerPlayer = bytes[pos + 1] & 127;
+        g.lazyDeck = bytes[pos + 1] >= 128;
+        memcpy(&g.rng, &bytes[pos + 2], sizeof(Rng));
+        memcpy(&g.reshuffleRng, &bytes[pos + 2 + sizeof(Rng)], sizeof(Rng));
+        pos += 2 + 2 * sizeof(Rng);
+
+        g.events = &bytes[pos];
+        g.numEvents = 0;
+        while (pos + 2 <= bytes.size()) {
+            int type = bytes[pos] >> 4;
+            if (type == EV_GAME_START) break;
+            pos += 2;
+            g.numEvents++;
+            if (type == EV_GAME_END) break;
+        }
+        games.push_back(g);
+    }
+    return true;
+}
+
+// Replays one game up to (not including) turn 'stopTurn', -1 = to the end.
+// Returns the number of turns replayed, or -1 if the log does not match.
+int replayGame(const LoggedGame &g, GameState &state, int stopTurn, int &winner) {
+    DeckManagement module1(state);
+    GameRules module3(state);
+    module1.setQuiet(true);
+    module3.setQuiet(true);
+
+    GameConfig config;
+    config.numPlayers = g.numPlayers;
+    config.cardsPerPlayer = g.cardsPerPlayer;
+    config.lazyDeck = g.lazyDeck;
+    module1.setGameConfiguration(config);
+    state.rng = g.rng;
+    state.reshuffleRng = g.reshuffleRng;
+    module1.createDeck();
+    module1.dealCards();
+    module1.setTopCard();
+    module3.reset();
+
+    winner = -1;
+    int turn = 0, e = 0;
+    while (e < g.numEvents) {
+        int type = g.events[2 * e] >> 4;
+        int player = g.events[2 * e] & 15;
+        int payload = g.events[2 * e + 1];
+
+        if (type == EV_GAME_END) {
+            winner = player == NO_WINNER ? -1 : player;
+            return turn;
+        }
+        if ((type != EV_PLAY && type != EV_DRAW) || player != state.currentPlayer) return -1;
+        if (turn == stopTurn) return turn;
+
+        // Gather the rest of this turn: everything up to the next play/draw
+        int end = e + 1;
+        while (end < g.numEvents) {
+            int t = g.events[2 * end] >> 4;
+            if (t == EV_PLAY || t == EV_DRAW || t == EV_GAME_END) break;
+            end++;
+        }
+
+        Move m = Move::draw();
+        if (type == EV_PLAY) {
+            const Hand &hand = state.hands[player];
+            int slot = -1;
+            for (int i = 0; i < hand.size() && slot < 0; i++)
+                if (hand[i].code == payload) slot = i;
+            if (slot < 0) return -1;
+            m = Move::play(slot);
+            for (int k = e + 1; k < end; k++) {
+                int t = g.events[2 * k] >> 4, p = g.events[2 * k] & 15;
+                if (t == EV_COLOR) m.color = g.events[2 * k + 1];
+                if (t == EV_PENALTY && p == player && hand.size() == 2) m.callUNO = false;
+            }
+        }
+
+        // Play it and check every drawn card against the log
+        int base[MAX_PLAYERS];
+        for (int p = 0; p < state.numPlayers; p++) base[p] = state.hands[p].size();
+        if (type == EV_PLAY) base[player]--;
+
+        MoveUndo undo;
+        int w = applyMove(state, m, undo);
+
+        int d = 0;
+        for (int k = e; k < end; k++) {
+            int t = g.events[2 * k] >> 4, p = g.events[2 * k] & 15;
+            if (t != EV_DRAW && t != EV_PENALTY) continue;
+            if (d >= undo.drawCount || undo.drawnBy[d] != p ||
+                state.hands[p][base[p]++].code != g.events[2 * k + 1]) return -1;
+            d++;
+        }
+        if (d != undo.drawCount) return -1;
+
+        turn++;
+        e = end;
+        if (w >= 0) {
+            winner = w;
+            return turn;
+        }
+    }
+    return turn;
+}
+
+// --replay: checks every game in the log, or shows one game at one turn
+int runReplay(const string &path, int gameIndex, int turn) {
+    ifstream in(path.c_str(), ios::binary);
+    vector<unsigned char> bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    vector<LoggedGame> games;
+    if (!in.is_open() && bytes.empty()) {
+        cout << "Cannot open " << path << "\n";
+        return 1;
+    }
+    if (!parseEventLog(bytes, games)) {
+        cout << path << " is not a game event log\n";
+        return 1;
+    }
+
+    unsigned long long seed;
+    memcpy(&seed, &bytes[8], 8);
+    cout << path << ": " << games.size() << " games, seed " << seed << "\n";
+
+    GameState state;
+    int winner;
+
+    // One game, stopped before the given turn
+    if (gameIndex >= 0) {
+        if (gameIndex >= (int)games.size()) {
+            cout << "No game " << gameIndex << " in the log\n";
+            return 1;
+        }
+        int turns = replayGame(games[gameIndex], state, turn, winner);
+        if (turns < 0) {
+            cout << "Game " << gameIndex << " does not match the rules\n";
+            return 1;
+        }
+        PlayerManagement module2;
+        cout << "Game " << gameIndex << ", before turn " << turns << " ("
+             << (state.isClockwise ? "clockwise" : "counter-clockwise") << ")\n";
+        cout << "Top card: " << state.topCard.name() << "\n";
+        for (int p = 0; p < state.numPlayers; p++) {
+            stringstream ss; ss << "Player " << p + 1 << (p == state.currentPlayer ? " (to move)" : "");
+            module2.displayPlayerHand(ss.str(), state.hands[p]);
+        }
+        cout << "Draw pile: " << state.drawPileSize() << " cards\n";
+        return 0;
+    }
+
+    // Whole log
+    long long turns = 0;
+    int bad = 0;
+    for (size_t i = 0; i < games.size(); i++) {
+        int t = replayGame(games[i], state, -1, winner);
+        if (t < 0) {
+            if (bad++ < 10) cout << "Game " << i << " does not match the rules\n";
+            continue;
+        }
+        turns += t;
+    }
+    cout << "Replayed " << turns << " turns, " << bad << " mismatched games\n";
+    return bad == 0 ? 0 : 1;
+}
+
+// ======================================================
+//                     GAME CORPUS
+// ======================================================
+// Segment file for millions of recorded games that is read with mmap and
+// used in place (no parsing, no copies):
+//
+//   CorpusFileHeader                      64 bytes
+//   game 0: CorpusGameHeader              96 bytes
+//           dealt hands                   numPlayers * cardsPerPlayer card bytes
+//           events                        numEvents * 2 bytes (EventLog records)
+//           padding to a multiple of 8
+//   game 1: ...
+//   index                                 one 8-byte file offset per game
+//
+// All fields are little-endian, as written by the machine that built it.
+
+const char CORPUS_MAGIC[8] = {'U', 'N', 'O', 'C', 'O', 'R', 'P', '2'};
+
+struct CorpusFileHeader {
+    char magic[8];
+    unsigned long long seed;
+    unsigned long long numGames;
+    unsigned long long indexOffset;   // Where the offset index starts
+    unsigned long long reserved[4];
+};
+
+struct CorpusGameHeader {
+    Rng rng;                     // Generator state the deck was shuffled with
+    Rng reshuffleRng;            // and the one for reshuffles
+    unsigned int numEvents;
+    unsigned short numTurns;
+    unsigned char numPlayers;
+    unsigned char cardsPerPlayer;
+    unsigned char winner;        // NO_WINNER = draw
+    Card firstTopCard;
+    unsigned char lazyDeck;      // 1 = dealt from the count-based deck (--lazy-deck)
+    unsigned char reserved[21];
+};
+
+static_assert(sizeof(CorpusFileHeader) == 64, "corpus file header must stay 64 bytes");
+static_assert(sizeof(CorpusGameHeader) == 96, "corpus game header must stay 96 bytes");
+
+// Collects games from the game loop and writes the corpus file
+class CorpusWriter {
+private:
+    ofstream out;
+    CorpusFileHeader fileHeader;
+    CorpusGameHeader game;
+    Card dealt[MAX_PLAYERS * 10];
+    vector<unsigned long long> index;
+    unsigned long long offset;
+    long long skipped;
+    long long droppedBefore;   // log.droppedBytes() when the game began
+
+public:
+    CorpusWriter() : offset(0), skipped(0), droppedBefore(0) {}
+    ~CorpusWriter() { close(); }
+
+    bool open(const string &path, unsigned long long seed, long long expectedGames) {
+        out.open(path.c_str(), ios::binary | ios::trunc);
+        if (!out) return false;
+        memset(&fileHeader, 0, sizeof(fileHeader));
+        memcpy(fileHeader.magic, CORPUS_MAGIC, 8);
+        fileHeader.seed = seed;
+        out.write((const char *)&fileHeader, sizeof(fileHeader));   // Rewritten by close()
+        offset = sizeof(fileHeader);
+        index.reserve(expectedGames);
+        return true;
+    }
+
+    long long gamesWritten() const { return (long long)index.size(); }
+    long long gamesSkipped() const { return skipped; }
+
+    // Called after dealing: remembers the starting hands and top card
+    void beginGame(const GameState &state, const EventLog &log) {
+        droppedBefore = log.droppedBytes();
+        game = CorpusGameHeader();   // Zeroes the reserved bytes too
+        game.numPlayers = (unsigned char)state.numPlayers;
+        game.lazyDeck = state.lazyDeck ? 1 : 0;
+        game.cardsPerPlayer = (unsigned char)state.cardsPerPlayer;
+        game.firstTopCard = state.topCard;
+        for (int p = 0; p < state.numPlayers; p++)
+            for (int i = 0; i < state.cardsPerPlayer; i++)
+                dealt[p * state.cardsPerPlayer + i] = state.hands[p][i];
+    }
+
+    // Called after the game: 'log' holds exactly this game's events
+    // (GAME_START ... GAME_END), which are copied into the file.
+    // False if the game had more events than the log buffer holds, so
+    // part of it was lost and nothing is stored.
+    bool endGame(const EventLog &log, int winner) {
+        const unsigned char *ev = (const unsigned char *)log.pending();
+        int n = log.pendingBytes();
+        int start = 2 + 2 * (int)sizeof(Rng);
+        if (log.droppedBytes() != droppedBefore || n < start + 2 ||
+            (ev[0] >> 4) != EV_GAME_START || (ev[n - 2] >> 4) != EV_GAME_END) {
+            skipped++;
+            return false;
+        }
+
+        memcpy(&game.rng, ev + 2, sizeof(Rng));
+        memcpy(&game.reshuffleRng, ev + 2 + sizeof(Rng), sizeof(Rng));
+        game.numEvents = (unsigned int)((n - start - 2) / 2);   // Without GAME_END
+        game.winner = (unsigned char)(winner < 0 ? NO_WINNER : winner);
+        int turns = 0;
+        for (int i = start; i < n - 2; i += 2) {
+            int type = ev[i] >> 4;
+            if (type == EV_PLAY || type == EV_DRAW) turns++;
+        }
+        game.numTurns = (unsigned short)min(turns, 65535);
+
+        int dealtBytes = game.numPlayers * game.cardsPerPlayer;
+        int eventBytes = game.numEvents * 2;
+        int size = (int)sizeof(game) + dealtBytes + eventBytes;
+        static const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        int padding = (8 - size % 8) % 8;
+
+        index.push_back(offset);
+        out.write((const char *)&game, sizeof(game));
+        out.write((const char *)dealt, dealtBytes);
+        out.write((const char *)ev + start, eventBytes);
+        out.write(zeros, padding);
+        offset += size + padding;
+        return true;
+    }
+
+    // Writes the index and the final file header
+    void close() {
+        if (!out.is_open()) return;
+        fileHeader.numGames = index.size();
+        fileHeader.indexOffset = offset;
+        if (!index.empty())
+            out.write((const char *)&index[0], index.size() * sizeof(unsigned long long));
+        out.seekp(0);
+        out.write((const char *)&fileHeader, sizeof(fileHeader));
+        out.close();
+    }
+};
+
+// One decoded event of a corpus game
+struct GameEvent {
+    int type;
+    int player;
+    int payload;
+    int turn;      // 1 = first turn of the game
+};
+
+// A game inside the mapped file (just pointers into it)
+struct CorpusGame {
+    const CorpusGameHeader *header;
+    const Card *dealt;
+    const unsigned char *events;
+
+    int numPlayers() const { return header->numPlayers; }
+    int winner() const { return header->winner == NO_WINNER ? -1 : header->winner; }
+
+    // Starting hand of player p
+    const Card *startingHand(int p) const { return dealt + p * header->cardsPerPlayer; }
+
+    // The game as replayGame() takes it (the events stop before GAME_END)
+    LoggedGame loggedGame() const {
+        LoggedGame g;
+        g.numPlayers = header->numPlayers;
+        g.cardsPerPlayer = header->cardsPerPlayer;
+        g.lazyDeck = header->lazyDeck != 0;
+        g.rng = header->rng;
+        g.reshuffleRng = header->reshuffleRng;
+        g.events = events;
+        g.numEvents = (int)header->numEvents;
+        return g;
+    }
+
+    // Calls fn(const GameEvent &) for every event in order; stops early if fn returns true
+    template <class Fn>
+    bool forEachEvent(Fn fn) const {
+        GameEvent e;
+        e.turn = 0;
+        for (unsigned int i = 0; i < header->numEvents; i++) {
+            e.type = events[2 * i] >> 4;
+            e.player = events[2 * i] & 15;
+            e.payload = events[2 * i + 1];
+            if (e.type == EV_PLAY || e.type == EV_DRAW) e.turn++;
+            if (fn(e)) return true;
+        }
+        return false;
+    }
+};
+
+// Read-only view of a corpus file. Uses mmap where available, so opening
+// a file of any size is instant and pages are loaded as they are scanned.
+class CorpusReader {
+private:
+    const unsigned char *base;
+    size_t size;
+    vector<unsigned char> copy;   // Only used without mmap
+    const CorpusFileHeader *header;
+    const unsigned long long *index;
+
+public:
+    CorpusReader() : base(NULL), size(0), header(NULL), index(NULL) {}
+    ~CorpusReader() { close(); }
+
+    CorpusReader(const CorpusReader &) = delete;
+    CorpusReader &operator=(const CorpusReader &) = delete;
+
+    bool open(const string &path) {
+#ifdef _WIN32
+        ifstream in(path.c_str(), ios::binary);
+        if (!in) return false;
+        copy.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        base = copy.empty() ? NULL : &copy[0];
+        size = copy.size();
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(CorpusFileHeader)) {
+            ::close(fd);
+            return false;
+        }
+        size = (size_t)st.st_size;
+        void *p = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        base = (const unsigned char *)p;
+#endif
+        if (size < sizeof(CorpusFileHeader)) return false;
+        header = (const CorpusFileHeader *)base;
+        if (memcmp(header->magic, CORPUS_MAGIC, 8) != 0 || header->indexOffset > size ||
+            header->numGames > (size - header->indexOffset) / 8) {
+            close();
+            return false;
+        }
+        index = (const unsigned long long *)(base + header->indexOffset);
+        return true;
+    }
+
+    void close() {
+#ifndef _WIN32
+        if (base) munmap((void *)base, size);
+#endif
+        copy.clear();
+        base = NULL;
+        header = NULL;
+        index = NULL;
+        size = 0;
+    }
+
+    long long numGames() const { return header ? (long long)header->numGames : 0; }
+    unsigned long long seed() const { return header->seed; }
+
+    // Game i, or false if its index entry or sizes point outside the file
+    bool game(long long i, CorpusGame &g) const {
+        if (i < 0 || i >= numGames()) return false;
+        unsigned long long offset = index[i];
+        if (offset > size || size - offset < sizeof(CorpusGameHeader)) return false;
+        const unsigned char *p = base + offset;
+        g.header = (const CorpusGameHeader *)p;
+        unsigned long long bytes = sizeof(CorpusGameHeader) +
+                                   (unsigned long long)g.header->numPlayers * g.header->cardsPerPlayer +
+                                   2ULL * g.header->numEvents;
+        if (size - offset < bytes) return false;
+        g.dealt = (const Card *)(p + sizeof(CorpusGameHeader));
+        g.events = p + sizeof(CorpusGameHeader) + g.header->numPlayers * g.header->cardsPerPlayer;
+        return true;
+    }
+};
+
+// Runs visit(game, result) over every game on 'threads' threads. Each
+// thread fills its own Result, and the results are added together with
+// Result::merge at the end, so the scan shares nothing while it runs.
+// Games that do not fit in the file (damaged corpus) are skipped.
+template <class Result, class Visit>
+Result scanCorpus(const CorpusReader &corpus, int threads, Visit visit) {
+    long long n = corpus.numGames();
+    threads = max(1, min(threads, MAX_SEARCH_THREADS));
+    vector<Result> partial(threads);
+    vector<long long> damaged(threads, 0);
+
+    auto work = [&](int t) {
+        CorpusGame g;
+        for (long long i = n * t / threads; i < n * (t + 1) / threads; i++) {
+            if (corpus.game(i, g)) visit(g, partial[t]);
+            else damaged[t]++;
+        }
+    };
+
+    vector<thread> workers;
+    for (int t = 1; t < threads; t++) workers.push_back(thread(work, t));
+    work(0);
+    for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+
+    for (int t = 1; t < threads; t++) {
+        partial[0].merge(partial[t]);
+        damaged[0] += damaged[t];
+    }
+    if (damaged[0] > 0) cout << "Skipped " << damaged[0] << " games that do not fit in the file\n";
+    return partial[0];
+}
+
+// Plays 'games' games and stores them all in a corpus file.
+// False if the file cannot be written or a game could not be stored.
+template <class Bot>
+bool buildCorpus(const string &path, long long games, int numPlayers, int cardsPerPlayer,
+                 unsigned long long seed) {
+    CorpusWriter corpus;
+    if (!corpus.open(path, seed, games)) {
+        cout << "Cannot write " << path << "\n";
+        return false;
+    }
+    static EventLog log;   // Never opened: only buffers the current game
+    GameEngine<Bot> engine(numPlayers, cardsPerPlayer, seed);
+    engine.setEventLog(&log);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    RngStreams streams(seed);
+    for (long long g = 0; g < games; g++) {
+        log.discardPending();
+        engine.seedGame(streams, g);
+        engine.deal();
+        corpus.beginGame(engine.state, log);
+        if (!corpus.endGame(log, engine.play()))
+            cout << "Game " << g << " has more than " << EventLog::BUFFER_BYTES
+                 << " bytes of events and is not stored\n";
+    }
+    corpus.close();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "Wrote " << corpus.gamesWritten() << " games to " << path << " in " << seconds
+         << " s (" << corpus.gamesSkipped() << " skipped)\n";
+    return corpus.gamesSkipped() == 0;
+}
+
+// ---- Built-in queries ----
+
+// Counts games and wins, used by every query
+struct QueryCount {
+    long long games, matches, wins;
+    QueryCount() : games(0), matches(0), wins(0) {}
+    void merge(const QueryCount &o) {
+        games += o.games;
+        matches += o.matches;
+        wins += o.wins;
+    }
+};
+
+// Win counts bucketed by something about the starting hand
+struct StartingHandStats {
+    long long hands[11], wins[11];
+    StartingHandStats() {
+        for (int i = 0; i < 11; i++) hands[i] = wins[i] = 0;
+    }
+    void merge(const StartingHandStats &o) {
+        for (int i = 0; i < 11; i++) {
+            hands[i] += o.hands[i];
+            wins[i] += o.wins[i];
+        }
+    }
+};
+
+// --corpus query <file> <query> [threads]
+int runCorpusQuery(const string &path, const string &query, int threads) {
+    CorpusReader corpus;
+    if (!corpus.open(path)) {
+        cout << "Cannot open corpus " << path << "\n";
+        return 1;
+    }
+    cout << path << ": " << corpus.numGames() << " games, seed " << corpus.seed() << "\n";
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    if (query == "plus4-turn1") {
+        // Games where a +4 was played on the first turn, and how often its player won
+        QueryCount r = scanCorpus<QueryCount>(corpus, threads,
+            [](const CorpusGame &g, QueryCount &out) {
+                out.games++;
+                int player = -1;
+                g.forEachEvent([&](const GameEvent &e) {
+                    if (e.turn > 1) return true;
+                    if (e.type == EV_PLAY && (e.payload & 31) == WILD_DRAW_FOUR)
+                        player = e.player;
+                    return false;
+                });
+                if (player < 0) return;
+                out.matches++;
+                if (g.winner() == player) out.wins++;
+            });
+        cout << "+4 on turn 1: " << r.matches << " of " << r.games << " games, its player won "
+             << (r.matches ? 100.0 * r.wins / r.matches : 0.0) << "%\n";
+    } else if (query == "wilds" || query == "actions") {
+        // Win rate by the number of wild (or action) cards in the starting hand
+        bool wilds = query == "wilds";
+        StartingHandStats r = scanCorpus<StartingHandStats>(corpus, threads,
+            [wilds](const CorpusGame &g, StartingHandStats &out) {
+                for (int p = 0; p < g.numPlayers(); p++) {
+                    const Card *hand = g.startingHand(p);
+                    int k = 0;
+                    for (int i = 0; i < g.header->cardsPerPlayer; i++) {
+                        CardType t = hand[i].getType();
+                        if (wilds ? (t == WILD_CARD || t == WILD_DRAW_FOUR)
+                                  : (t == SKIP || t == REVERSE || t == DRAW_TWO)) k++;
+                    }
+                    out.hands[k]++;
+                    if (g.winner() == p) out.wins[k]++;
+                }
+            });
+        for (int k = 0; k < 11; k++)
+            if (r.hands[k] > 0)
+                cout << k << " " << query << " in starting hand: " << r.hands[k] << " hands, win rate "
+                     << 100.0 * r.wins[k] / r.hands[k] << "%\n";
+    } else if (query == "summary") {
+        QueryCount r = scanCorpus<QueryCount>(corpus, threads,
+            [](const CorpusGame &g, QueryCount &out) {
+                out.games++;
+                out.matches += g.header->numTurns;   // Total turns
+                if (g.winner() < 0) out.wins++;      // Draws
+            });
+        cout << "Average turns per game: " << (r.games ? (double)r.matches / r.games : 0.0)
+             << ", draws: " << r.wins << "\n";
+    } else if (query == "replay") {
+        // Every game dealt again and played from its events, as --replay does
+        QueryCount r = scanCorpus<QueryCount>(corpus, threads,
+            [](const CorpusGame &g, QueryCount &out) {
+                GameState state;
+                int winner;
+                out.games++;
+                if (replayGame(g.loggedGame(), state, -1, winner) >= 0 && winner == g.winner())
+                    out.matches++;
+            });
+        cout << "Replayed " << r.matches << " of " << r.games << " games exactly\n";
+    } else {
+        cout << "Unknown query '" << query << "' (plus4-turn1, wilds, actions, summary, replay)\n";
+        return 1;
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Scanned in " << seconds << " s (" << (seconds > 0 ? corpus.numGames() / seconds : 0.0)
+         << " games/sec, " << max(1, threads) << " threads)\n";
+    return 0;
+}
+
+// ======================================================
+//              REINFORCEMENT LEARNING ENVIRONMENT
+// ======================================================
+// N games stepped together for training a policy. The agent always sits
+// in seat 0; the other seats are played by the Opponent bot class. After
+// reset(batch, seeds) and after every step(batch, actions), the results
+// are in flat buffers that a training framework can wrap without copying:
+//
+//   observations  float[N][OBS_SIZE]
+//     [0, 54)    own hand: number of cards of each kind
+//     [54, 108)  top card kind (one-hot)
+//     [108, 112) color in play, including the color chosen for a wild (one-hot)
+//     [112, 121) hand sizes of the other players, next player first (0 = no seat)
+//     [121]      direction: 1 clockwise, -1 counter-clockwise
+//   actionMasks   int8[N][NUM_ACTIONS], 1 = legal
+//     [0, 52)    play a card of colored kind k (color * 13 + 0-9/skip/reverse/+2)
+//     [52, 56)   play a wild and choose red/blue/green/yellow
+//     [56, 60)   play a +4 and choose red/blue/green/yellow
+//     [60]       draw a card
+//   rewards       float[N]: +1 win, -1 loss, 0 otherwise (also 0 for a drawn game)
+//   dones         int8[N]: 1 if the game ended in this step
+//
+// A finished game is dealt again at once (new seed), so the observation
+// after done is the first one of the next game. Moves are played with
+// applyMove(), which follows playerTurn/checkUNO/applySpecialCard exactly;
+// an illegal action draws a card, like an invalid choice in playerTurn.
+// All buffers are allocated by reset(); step() never allocates.
+
+const int NUM_ACTIONS = 61;
+const int DRAW_ACTION = 60;
+const int OBS_SIZE = 2 * NUM_CARD_KINDS + 4 + (MAX_PLAYERS - 1) + 1;
+
+// A bot's decision turned into a Move (the color is asked for with the
+// played card already out of the hand, as in applySpecialCard)
+template <class Bot>
+Move botMove(Bot &bot, const GameState &s) {
+    const Hand &hand = s.hands[s.currentPlayer];
+    int choice = bot.chooseCard(hand, s.topCard);
+    if (choice <= 0 || choice > hand.size()) return Move::draw();
+
+    Move m = Move::play(choice - 1);
+    if (hand[choice - 1].getColor() == WILD) {
+        Hand rest = hand;
+        rest.removeAt(choice - 1);
+        m.color = (unsigned char)bot.chooseColor(rest);
+    }
+    return m;
+}
+
+template <class Opponent = FirstPlayableBot>
+class VecEnv {
+private:
+    int numPlayers, cardsPerPlayer;
+    int batch;
+    vector<GameState> games;
+    vector<unsigned long long> seeds;
+    vector<long long> episodes;
+    vector<float> obs;
+    vector<signed char> masks;
+    vector<float> rewardBuf;
+    vector<signed char> doneBuf;
+
+    // Deals new games in a scratch state and copies them into place
+    GameState dealer;
+    DeckManagement module1;
+    GameRules module3;
+    Opponent opponents[MAX_PLAYERS];
+
+    void deal(int i) {
+        module1.seedShuffle(seeds[i] + 0x9E3779B97F4A7C15ULL * episodes[i]++);
+        module1.createDeck();
+        module1.dealCards();
+        module1.setTopCard();
+        module3.reset();
+        games[i] = dealer;
+    }
+
+    // Opponents move until it is the agent's turn or the game is over.
+    // Returns the winner, or -1.
+    int playOpponents(GameState &s) {
+        MoveUndo undo;
+        int winner = -1;
+        while (!isGameOver(s, winner) && s.currentPlayer != 0)
+            winner = applyMove(s, botMove(opponents[s.currentPlayer], s), undo);
+        return winner;
+    }
+
+    void observe(int i) {
+        const GameState &s = games[i];
+        float *o = &obs[(size_t)i * OBS_SIZE];
+        signed char *mask = &masks[(size_t)i * NUM_ACTIONS];
+        memset(o, 0, OBS_SIZE * sizeof(float));
+        memset(mask, 0, NUM_ACTIONS);
+
+        const Hand &hand = s.hands[0];
+        MoveMask legal = legalMoves(hand, s.topCard);
+        for (int k = 0; k < hand.size(); k++) {
+            int kind = cardKind(hand[k]);
+            o[kind] += 1;
+            if (!legal.test(k)) continue;
+            if (kind < 52) {
+                mask[kind] = 1;
+            } else {
+                for (int c = 0; c < 4; c++) mask[52 + (kind - 52) * 4 + c] = 1;
+            }
+        }
+        mask[DRAW_ACTION] = 1;
+
+        o[NUM_CARD_KINDS + cardKind(s.topCard)] = 1;
+        Color color = s.topCard.getColor();
+        if (color >= RED && color <= YELLOW) o[2 * NUM_CARD_KINDS + color] = 1;
+
+        int p = 0;
+        for (int k = 1; k < s.numPlayers; k++) {
+            p = s.nextPlayer(p);
+            o[2 * NUM_CARD_KINDS + 4 + k - 1] = (float)s.hands[p].size();
+        }
+        o[OBS_SIZE - 1] = s.isClockwise ? 1.0f : -1.0f;
+    }
+
+    // Turns an action number into a move for the agent's hand
+    Move actionToMove(const GameState &s, int action) const {
+        const Hand &hand = s.hands[0];
+        if (action < 0 || action >= DRAW_ACTION) return Move::draw();
+
+        int kind = action < 52 ? action : 52 + (action - 52) / 4;
+        for (int k = 0; k < hand.size(); k++) {
+            if (cardKind(hand[k]) != kind) continue;
+            return Move::play(k, action < 52 ? RED : (Color)((action - 52) % 4));
+        }
+        return Move::draw();   // Card not in hand: drawn like an invalid choice
+    }
+
+public:
+    VecEnv(int players = 4, int cards = 7)
+        : numPlayers(players), cardsPerPlayer(cards), batch(0), module1(dealer), module3(dealer) {
+        module1.setQuiet(true);
+        module3.setQuiet(true);
+        GameConfig config;
+        config.numPlayers = players;
+        config.cardsPerPlayer = cards;
+        module1.setGameConfiguration(config);
+        for (int i = 0; i < MAX_PLAYERS; i++) opponents[i].setup(i, 12345);
+    }
+
+    int batchSize() const { return batch; }
+    const float *observations() const { return &obs[0]; }
+    const signed char *actionMasks() const { return &masks[0]; }
+    const float *rewards() const { return &rewardBuf[0]; }
+    const signed char *dones() const { return &doneBuf[0]; }
+
+    // Starts n games, game i dealt from seeds[i]
+    void reset(int n, const unsigned long long *newSeeds) {
+        if (n != batch) {
+            batch = n;
+            games.resize(n);
+            seeds.resize(n);
+            episodes.resize(n);
+            obs.resize((size_t)n * OBS_SIZE);
+            masks.resize((size_t)n * NUM_ACTIONS);
+            rewardBuf.resize(n);
+            doneBuf.resize(n);
+        }
+        for (int i = 0; i < n; i++) {
+            seeds[i] = newSeeds[i];
+            episodes[i] = 0;
+            rewardBuf[i] = 0;
+            doneBuf[i] = 0;
+            deal(i);
+            while (playOpponents(games[i]) >= 0 || !games[i].canDraw()) deal(i);
+            observe(i);
+        }
+    }
+
+    // Plays actions[i] in game i for the first n games (n <= batch size)
+    void step(int n, const int *actions) {
+        MoveUndo undo;
+        for (int i = 0; i < n && i < batch; i++) {
+            GameState &s = games[i];
+            int winner = applyMove(s, actionToMove(s, actions[i]), undo);
+            if (winner < 0) winner = playOpponents(s);
+
+            bool done = isGameOver(s, winner);
+            rewardBuf[i] = !done || winner < 0 ? 0.0f : (winner == 0 ? 1.0f : -1.0f);
+            doneBuf[i] = done;
+            if (done) {
+                deal(i);
+                while (playOpponents(games[i]) >= 0 || !games[i].canDraw()) deal(i);
+            }
+            observe(i);
+        }
+    }
+};
+
+// --env: steps a batch of games with random legal actions and reports speed
+void runEnvDemo(int numEnvs, int steps, int numPlayers, int cardsPerPlayer,
+                unsigned long long seed) {
+    VecEnv<FirstPlayableBot> env(numPlayers, cardsPerPlayer);
+    vector<unsigned long long> seeds(numEnvs);
+    vector<int> actions(numEnvs);
+    for (int i = 0; i < numEnvs; i++) seeds[i] = seed + i;
+    env.reset(numEnvs, &seeds[0]);
+
+    Rng rng(seed);
+    long long episodes = 0, wins = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    for (int t = 0; t < steps; t++) {
+        // Random legal action (a real agent would run its network here)
+        const signed char *masks = env.actionMasks();
+        for (int i = 0; i < numEnvs; i++) {
+            const signed char *mask = masks + (size_t)i * NUM_ACTIONS;
+            int legal = 0;
+            for (int a = 0; a < NUM_ACTIONS - 1; a++) legal += mask[a];
+            int k = legal > 0 ? (int)rng.below(legal) : 0;
+            int action = DRAW_ACTION;
+            for (int a = 0; a < NUM_ACTIONS - 1 && legal > 0; a++)
+                if (mask[a] && k-- == 0) {
+                    action = a;
+                    break;
+                }
+            actions[i] = action;
+        }
+
+        env.step(numEnvs, &actions[0]);
+        for (int i = 0; i < numEnvs; i++) {
+            episodes += env.dones()[i];
+            wins += env.rewards()[i] > 0;
+        }
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    long long envSteps = (long long)numEnvs * steps;
+    cout << numEnvs << " envs x " << steps << " steps in " << seconds << " s ("
+         << (seconds > 0 ? envSteps / seconds : 0.0) << " env steps/sec, policy included)\n";
+    cout << "Episodes finished: " << episodes << ", agent (random legal actions) won "
+         << (episodes ? 100.0 * wins / episodes : 0.0) << "%\n";
+}
+
+// ======================================================
+//                LOCKSTEP BATCH ENGINE
+// ======================================================
+// Plays N games at once, all seats FirstPlayableBot, one turn of every
+// game per step. The per-game values every turn touches are stored as
+// struct-of-arrays (one byte per game) so whole rows can be processed
+// with AVX2, 32 games per instruction:
+//   topColor, topType, current, clockwise, effect, active, handCount[p]
+// The cards themselves (hands, draw and discard piles, reshuffle
+// generator) stay in one GameState per game.
+//
+// A turn is split into phases:
+//   1. choose (AVX2 over games): first playable card of the player to move,
+//      8 games per vector, reading their hands with gathers; handCount
+//      tells each game where its hand ends
+//   2. play or draw (scalar, moves cards, updates handCount)
+//   2b. winners (AVX2 over games): a hand count of 0 ends the game
+//   3. effects (AVX2 over games): skip / reverse / penalty size / wild color needed
+//   4. penalty targets (AVX2 next player), penalty draws and wild colors (scalar)
+//   5. advance (AVX2 next player, twice when skipping)
+// Games are run in blocks of BATCH_BLOCK so the GameStates of a block
+// stay in cache between steps. Each kernel has a scalar version. Both give exactly the same games as
+// GameEngine<FirstPlayableBot> with the same seeds (checked by --batch).
+
+// ---- Scalar kernels ----
+
+// Index of the first card that fits the top card, -1 if none (isValidMove
+// rule: a wild card type, the same color or the same type)
+int firstPlayableScalar(const Card *cards, int count, int topColor, int topType) {
+    for (int i = 0; i < count; i++) {
+        int color = cards[i].code >> 5, typeValue = cards[i].code & 31;
+        if (typeValue >= WILD_CARD || color == topColor || typeValue == topType) return i;
+    }
+    return -1;
+}
+
+// Where the hands are inside the GameStates of a batch
+struct HandLayout {
+    int gameBytes;    // sizeof(GameState)
+    int cardsAt;      // Offset of hands[0].cards in a GameState
+    int handBytes;    // sizeof(Hand)
+};
+
+// Phase 1 for every active game: slot[g] = first playable card of the
+// player to move (whose hand has handCount[current * stride + g] cards)
+void firstPlayablesScalar(int n, const GameState *games, int stride, const unsigned char *current,
+                          const unsigned char *handCount, const unsigned char *topColor,
+                          const unsigned char *topType, const unsigned char *active,
+                          signed char *slot) {
+    for (int g = 0; g < n; g++) {
+        if (!active[g]) continue;
+        slot[g] = (signed char)firstPlayableScalar(games[g].hands[current[g]].cards,
+                                                   handCount[current[g] * stride + g],
+                                                   topColor[g], topType[g]);
+    }
+}
+
+// Phase 2b: games whose player to move has just emptied their hand are
+// won by them. Returns how many games are still running.
+int findWinnersScalar(int n, int numPlayers, int stride, const unsigned char *handCount,
+                      unsigned char *active, unsigned char *winner) {
+    int running = 0;
+    for (int g = 0; g < n; g++) {
+        for (int p = 0; p < numPlayers && active[g]; p++) {
+            if (handCount[p * stride + g] != 0) continue;
+            winner[g] = (unsigned char)p;
+            active[g] = 0;
+        }
+        running += active[g];
+    }
+    return running;
+}
+
+// What applySpecialCard does to each game, as 0/1 (or 0/2/4) flags
+void specialEffectsScalar(int n, bool twoPlayers, const unsigned char *topType,
+                          const unsigned char *active, unsigned char *effect,
+                          unsigned char *clockwise, unsigned char *skip,
+                          unsigned char *penalty, unsigned char *needColor) {
+    for (int g = 0; g < n; g++) {
+        int t = topType[g];
+        bool act = active[g] && !effect[g] && t >= SKIP;
+        bool isSkip = t == SKIP || t == DRAW_TWO || t == WILD_DRAW_FOUR || (t == REVERSE && twoPlayers);
+        skip[g] = act && isSkip;
+        clockwise[g] ^= (unsigned char)(act && t == REVERSE && !twoPlayers);
+        penalty[g] = !act ? 0 : (t == DRAW_TWO ? 2 : (t == WILD_DRAW_FOUR ? 4 : 0));
+        needColor[g] = act && (t == WILD_CARD || t == WILD_DRAW_FOUR);
+        effect[g] |= (unsigned char)act;
+    }
+}
+
+// GameState::nextPlayer for every game
+void nextPlayersScalar(int n, int numPlayers, const unsigned char *current,
+                       const unsigned char *clockwise, unsigned char *next) {
+    for (int g = 0; g < n; g++) {
+        int c = current[g];
+        next[g] = (unsigned char)(clockwise[g] ? (c + 1 == numPlayers ? 0 : c + 1)
+                                               : (c == 0 ? numPlayers - 1 : c - 1));
+    }
+}
+
+// End of turn: move on one player (two when skipping) in active games
+void advancePlayersScalar(int n, int numPlayers, unsigned char *current,
+                          const unsigned char *clockwise, const unsigned char *skip,
+                          const unsigned char *active) {
+    for (int g = 0; g < n; g++) {
+        if (!active[g]) continue;
+        for (int k = 0; k <= skip[g]; k++) {
+            int c = current[g];
+            current[g] = (unsigned char)(clockwise[g] ? (c + 1 == numPlayers ? 0 : c + 1)
+                                                      : (c == 0 ? numPlayers - 1 : c - 1));
+        }
+    }
+}
+
+#if HAVE_AVX2_KERNELS
+// ---- AVX2 kernels (n must be a multiple of 32) ----
+
+// Phase 1 across games. Every 32-bit lane is one game: its hand is read
+// one card at a time with a gather (only for active games, so no lane
+// reads a game that does not exist), until every game found a card or
+// ran out of cards.
+TARGET_AVX2 void firstPlayablesAvx2(int n, const GameState *games, HandLayout layout, int stride,
+                                    const unsigned char *current, const unsigned char *handCount,
+                                    const unsigned char *topColor, const unsigned char *topType,
+                                    const unsigned char *active, signed char *slot) {
+    const char *base = (const char *)games;
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i byte = _mm256_set1_epi32(0xFF), seven = _mm256_set1_epi32(7);
+    const __m256i low5 = _mm256_set1_epi32(31), wildType = _mm256_set1_epi32(WILD_CARD - 1);
+    const __m256i zero = _mm256_setzero_si256();
+
+    for (int g = 0; g < n; g += 8) {
+        __m256i live = _mm256_cmpgt_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(active + g))), zero);
+        if (_mm256_testz_si256(live, live)) continue;
+        __m256i cur = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(current + g)));
+        __m256i game = _mm256_add_epi32(_mm256_set1_epi32(g), lanes);
+
+        // handCount[cur * stride + game] and the address of each hand
+        __m256i countAt = _mm256_add_epi32(_mm256_mullo_epi32(cur, _mm256_set1_epi32(stride)), game);
+        __m256i count = _mm256_and_si256(byte, _mm256_mask_i32gather_epi32(
+            zero, (const int *)handCount, countAt, live, 1));
+        __m256i cards = _mm256_add_epi32(
+            _mm256_mullo_epi32(game, _mm256_set1_epi32(layout.gameBytes)),
+            _mm256_add_epi32(_mm256_set1_epi32(layout.cardsAt),
+                             _mm256_mullo_epi32(cur, _mm256_set1_epi32(layout.handBytes))));
+
+        __m256i color = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(topColor + g)));
+        __m256i type = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(topType + g)));
+        __m256i found = _mm256_set1_epi32(-1);
+
+        for (int i = 0;; i++) {
+            live = _mm256_and_si256(live, _mm256_cmpgt_epi32(count, _mm256_set1_epi32(i)));
+            if (_mm256_testz_si256(live, live)) break;
+            __m256i v = _mm256_and_si256(byte, _mm256_mask_i32gather_epi32(
+                zero, (const int *)(base + i), cards, live, 1));
+            __m256i c = _mm256_and_si256(_mm256_srli_epi32(v, 5), seven);
+            __m256i t = _mm256_and_si256(v, low5);
+            __m256i fits = _mm256_or_si256(_mm256_cmpgt_epi32(t, wildType),
+                           _mm256_or_si256(_mm256_cmpeq_epi32(c, color), _mm256_cmpeq_epi32(t, type)));
+            fits = _mm256_and_si256(fits, live);
+            found = _mm256_blendv_epi8(found, _mm256_set1_epi32(i), fits);
+            live = _mm256_andnot_si256(fits, live);
+        }
+
+        int out[8];
+        _mm256_storeu_si256((__m256i *)out, found);
+        for (int k = 0; k < 8; k++)
+            if (active[g + k]) slot[g + k] = (signed char)out[k];
+    }
+}
+
+// Phase 2b across games, 32 per vector: one compare per player row
+TARGET_AVX2 int findWinnersAvx2(int n, int numPlayers, int stride, const unsigned char *handCount,
+                                unsigned char *active, unsigned char *winner) {
+    const __m256i one = _mm256_set1_epi8(1), zero = _mm256_setzero_si256();
+    int running = 0;
+    for (int g = 0; g < n; g += 32) {
+        __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(active + g)), one);
+        __m256i w = _mm256_loadu_si256((const __m256i *)(winner + g));
+        for (int p = 0; p < numPlayers; p++) {
+            __m256i empty = _mm256_cmpeq_epi8(
+                _mm256_loadu_si256((const __m256i *)(handCount + p * stride + g)), zero);
+            __m256i won = _mm256_and_si256(a, empty);
+            w = _mm256_blendv_epi8(w, _mm256_set1_epi8((char)p), won);
+            a = _mm256_andnot_si256(won, a);
+        }
+        _mm256_storeu_si256((__m256i *)(winner + g), w);
+        _mm256_storeu_si256((__m256i *)(active + g), _mm256_and_si256(a, one));
+        running += __builtin_popcount((unsigned int)_mm256_movemask_epi8(a));
+    }
+    return running;
+}
+
+TARGET_AVX2 void specialEffectsAvx2(int n, bool twoPlayers, const unsigned char *topType,
+                                    const unsigned char *active, unsigned char *effect,
+                                    unsigned char *clockwise, unsigned char *skip,
+                                    unsigned char *penalty, unsigned char *needColor) {
+    const __m256i one = _mm256_set1_epi8(1), nine = _mm256_set1_epi8(9);
+    const __m256i two = twoPlayers ? _mm256_set1_epi8(-1) : _mm256_setzero_si256();
+    for (int g = 0; g < n; g += 32) {
+        __m256i t = _mm256_loadu_si256((const __m256i *)(topType + g));
+        __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(active + g)), one);
+        __m256i e = _mm256_loadu_si256((const __m256i *)(effect + g));
+        __m256i act = _mm256_andnot_si256(_mm256_cmpeq_epi8(e, one),
+                                          _mm256_and_si256(a, _mm256_cmpgt_epi8(t, nine)));
+
+        __m256i isSkip = _mm256_cmpeq_epi8(t, _mm256_set1_epi8(SKIP));
+        __m256i isReverse = _mm256_cmpeq_epi8(t, _mm256_set1_epi8(REVERSE));
+        __m256i isDrawTwo = _mm256_cmpeq_epi8(t, _mm256_set1_epi8(DRAW_TWO));
+        __m256i isWild = _mm256_cmpeq_epi8(t, _mm256_set1_epi8(WILD_CARD));
+        __m256i isDrawFour = _mm256_cmpeq_epi8(t, _mm256_set1_epi8(WILD_DRAW_FOUR));
+
+        __m256i skips = _mm256_or_si256(_mm256_or_si256(isSkip, isDrawTwo),
+                        _mm256_or_si256(isDrawFour, _mm256_and_si256(isReverse, two)));
+        __m256i flips = _mm256_andnot_si256(two, isReverse);
+        __m256i pen = _mm256_or_si256(_mm256_and_si256(isDrawTwo, _mm256_set1_epi8(2)),
+                                      _mm256_and_si256(isDrawFour, _mm256_set1_epi8(4)));
+
+        _mm256_storeu_si256((__m256i *)(skip + g), _mm256_and_si256(_mm256_and_si256(act, skips), one));
+        _mm256_storeu_si256((__m256i *)(penalty + g), _mm256_and_si256(act, pen));
+        _mm256_storeu_si256((__m256i *)(needColor + g),
+                            _mm256_and_si256(_mm256_and_si256(act, _mm256_or_si256(isWild, isDrawFour)), one));
+        __m256i cw = _mm256_loadu_si256((const __m256i *)(clockwise + g));
+        _mm256_storeu_si256((__m256i *)(clockwise + g),
+                            _mm256_xor_si256(cw, _mm256_and_si256(_mm256_and_si256(act, flips), one)));
+        _mm256_storeu_si256((__m256i *)(effect + g), _mm256_or_si256(e, _mm256_and_si256(act, one)));
+    }
+}
+
+// Next player of 32 games: clockwise ? (c + 1) mod n : (c - 1) mod n
+TARGET_AVX2 inline __m256i nextPlayers32(__m256i c, __m256i cwMask, __m256i last) {
+    const __m256i one = _mm256_set1_epi8(1), zero = _mm256_setzero_si256();
+    __m256i forward = _mm256_blendv_epi8(_mm256_add_epi8(c, one), zero, _mm256_cmpeq_epi8(c, last));
+    __m256i backward = _mm256_blendv_epi8(_mm256_sub_epi8(c, one), last, _mm256_cmpeq_epi8(c, zero));
+    return _mm256_blendv_epi8(backward, forward, cwMask);
+}
+
+TARGET_AVX2 void nextPlayersAvx2(int n, int numPlayers, const unsigned char *current,
+                                 const unsigned char *clockwise, unsigned char *next) {
+    const __m256i one = _mm256_set1_epi8(1), last = _mm256_set1_epi8((char)(numPlayers - 1));
+    for (int g = 0; g < n; g += 32) {
+        __m256i c = _mm256_loadu_si256((const __m256i *)(current + g));
+        __m256i cw = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(clockwise + g)), one);
+        _mm256_storeu_si256((__m256i *)(next + g), nextPlayers32(c, cw, last));
+    }
+}
+
+TARGET_AVX2 void advancePlayersAvx2(int n, int numPlayers, unsigned char *current,
+                                    const unsigned char *clockwise, const unsigned char *skip,
+                                    const unsigned char *active) {
+    const __m256i one = _mm256_set1_epi8(1), last = _mm256_set1_epi8((char)(numPlayers - 1));
+    for (int g = 0; g < n; g += 32) {
+        __m256i c = _mm256_loadu_si256((const __m256i *)(current + g));
+        __m256i cw = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(clockwise + g)), one);
+        __m256i sk = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(skip + g)), one);
+        __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(active + g)), one);
+        __m256i n1 = nextPlayers32(c, cw, last);
+        __m256i n2 = nextPlayers32(n1, cw, last);
+        __m256i r = _mm256_blendv_epi8(c, _mm256_blendv_epi8(n1, n2, sk), a);
+        _mm256_storeu_si256((__m256i *)(current + g), r);
+    }
+}
+#endif
+
+// Does this CPU run the AVX2 kernels?
+bool cpuHasAvx2() {
+#if HAVE_AVX2_KERNELS
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+const int BATCH_BLOCK = 256;   // Games stepped together (multiple of 32)
+
+class BatchEngine {
+private:
+    int numGames, stride;     // stride = numGames rounded up to 32
+    int numPlayers, cardsPerPlayer;
+    bool simd;
 
-        // If card is a normal number card, no special effect applies
-        if (playedCard.type == NUMBER) return;
+    vector<GameState> games;
+    vector<unsigned char> topColor, topType, current, clockwise, effect, active;
+    vector<unsigned char> skip, penalty, needColor, target, winner;
+    vector<signed char> slot;          // Card chosen in phase 1, -1 = draw
+    vector<unsigned char> handCount;   // [player * stride + game], +4 bytes for the gathers
+    vector<int> turns;
 
-        // Apply effect based on card type
-        switch (playedCard.type) {
+public:
+    BatchEngine(int players, int cards, bool useSimd)
+        : numGames(0), stride(0), numPlayers(players), cardsPerPlayer(cards),
+          simd(useSimd && cpuHasAvx2()) {}
 
-            // -------- SKIP CARD --------
-            case SKIP: {
-                cout << "Next player is skipped!\n";
-                currentPlayer = nextPlayer(currentPlayer, numPlayers); // Skip next player
-                break;
+    bool usesSimd() const { return simd; }
+    int winnerOf(int g) const { return winner[g] == NO_WINNER ? -1 : winner[g]; }
+    int turnsOf(int g) const { return turns[g]; }
+    const GameState &game(int g) const { return games[g]; }
+
+    // Deals game g from seeds[g], exactly like GameEngine::playGame after seedShuffle
+    void deal(int n, const unsigned long long *seeds) {
+        numGames = n;
+        stride = (n + 31) / 32 * 32;
+        games.resize(n);
+        vector<unsigned char> *rows[] = {&topColor, &topType, &current, &clockwise, &effect,
+                                         &active, &skip, &penalty, &needColor, &target};
+        for (size_t r = 0; r < sizeof(rows) / sizeof(rows[0]); r++) rows[r]->assign(stride, 0);
+        winner.assign(stride, NO_WINNER);
+        slot.assign(stride, -1);
+        handCount.assign((size_t)MAX_PLAYERS * stride + 4, 0);
+        turns.assign(n, 0);
+
+        GameState dealer;
+        DeckManagement module1(dealer);
+        GameRules module3(dealer);
+        module1.setQuiet(true);
+        GameConfig config;
+        config.numPlayers = numPlayers;
+        config.cardsPerPlayer = cardsPerPlayer;
+        module1.setGameConfiguration(config);
+
+        for (int g = 0; g < n; g++) {
+            module1.seedShuffle(seeds[g]);
+            module1.createDeck();
+            module1.dealCards();
+            module1.setTopCard();
+            module3.reset();
+            games[g] = dealer;
+
+            topColor[g] = (unsigned char)dealer.topCard.getColor();
+            topType[g] = (unsigned char)dealer.topCard.getTypeValue();
+            clockwise[g] = 1;
+            active[g] = 1;
+            for (int p = 0; p < numPlayers; p++) handCount[p * stride + g] = (unsigned char)cardsPerPlayer;
+        }
+    }
+
+    // Plays one turn of every unfinished game in [lo, hi). lo and hi are
+    // multiples of 32 (hi may be stride). Returns how many are still running.
+    int step(int lo, int hi) {
+        int end = min(hi, numGames), n = hi - lo;
+
+        // Phase 1: choose
+#if HAVE_AVX2_KERNELS
+        if (simd) {
+            const GameState *first = &games[0];
+            HandLayout layout = {(int)sizeof(GameState),
+                                 (int)((const char *)first->hands[0].cards - (const char *)first),
+                                 (int)sizeof(Hand)};
+            firstPlayablesAvx2(n, first + lo, layout, stride, &current[lo], &handCount[lo],
+                               &topColor[lo], &topType[lo], &active[lo], &slot[lo]);
+        } else
+#endif
+            firstPlayablesScalar(end - lo, &games[lo], stride, &current[lo], &handCount[lo],
+                                 &topColor[lo], &topType[lo], &active[lo], &slot[lo]);
+
+        // Phase 2: play (or draw)
+        for (int g = lo; g < end; g++) {
+            if (!active[g]) continue;
+            GameState &s = games[g];
+            if (!s.canDraw()) {            // Nothing left to draw: the game is a draw
+                active[g] = 0;
+                continue;
             }
 
-            // -------- REVERSE CARD --------
-            case REVERSE: {
-                if (numPlayers == 2) {
-                    // With only 2 players, reverse acts like skip
-                    cout << "Reverse card played!\n";
-                    currentPlayer = nextPlayer(currentPlayer, numPlayers);
-                } else {
-                    // With more than 2 players, reverse direction
-                    cout << "Direction reversed!\n";
-                    reverseDirection();
-                }
-                break;
+            int p = current[g];
+            Hand &h = s.hands[p];
+            turns[g]++;
+            if (slot[g] < 0) {
+                h.add(s.drawCard());
+            } else {
+                Card c = h.removeAt(slot[g]);
+                s.discardPile.push(c);
+                topColor[g] = (unsigned char)c.getColor();
+                topType[g] = (unsigned char)c.getTypeValue();
+                effect[g] = 0;
             }
+            handCount[p * stride + g] = h.count;
+        }
 
-            // -------- DRAW TWO CARD --------
-            case DRAW_TWO: {
-                int next = nextPlayer(currentPlayer, numPlayers);
-                cout << "Player " << next + 1 << " draws 2 cards!\n";
+        // Phase 2b: an empty hand wins (FirstPlayableBot always calls UNO)
+        int running;
+#if HAVE_AVX2_KERNELS
+        if (simd)
+            running = findWinnersAvx2(n, numPlayers, stride, &handCount[lo], &active[lo], &winner[lo]);
+        else
+#endif
+            running = findWinnersScalar(n, numPlayers, stride, &handCount[lo], &active[lo], &winner[lo]);
 
-                // Next player draws two cards from the deck
-                for (int i = 0; i < 2; i++) {
-                    if (!deck.isDeckEmpty()) {
-                        playerHands[next][handSizes[next]++] = deck.drawCard();
-                    }
-                }
+        // Phase 3: special card effects, and the player a penalty goes to
+#if HAVE_AVX2_KERNELS
+        if (simd) {
+            specialEffectsAvx2(n, numPlayers == 2, &topType[lo], &active[lo], &effect[lo],
+                               &clockwise[lo], &skip[lo], &penalty[lo], &needColor[lo]);
+            nextPlayersAvx2(n, numPlayers, &current[lo], &clockwise[lo], &target[lo]);
+        } else
+#endif
+        {
+            specialEffectsScalar(n, numPlayers == 2, &topType[lo], &active[lo], &effect[lo],
+                                 &clockwise[lo], &skip[lo], &penalty[lo], &needColor[lo]);
+            nextPlayersScalar(n, numPlayers, &current[lo], &clockwise[lo], &target[lo]);
+        }
 
-                currentPlayer = next; // Turn moves to the next player
-                break;
-            }
+        // Phase 4: penalty draws and wild colors
+        for (int g = lo; g < end; g++) {
+            if (!(penalty[g] | needColor[g])) continue;
+            GameState &s = games[g];
+            int t = target[g];
+            for (int k = 0; k < penalty[g]; k++)
+                if (s.canDraw()) s.hands[t].add(s.drawCard());
+            handCount[t * stride + g] = s.hands[t].count;
+            if (needColor[g]) topColor[g] = (unsigned char)majorityColor(s.hands[current[g]]);
+        }
 
-            // -------- WILD CARD --------
-            case WILD_CARD: {
-                string choice;
+        // Phase 5: next player
+#if HAVE_AVX2_KERNELS
+        if (simd)
+            advancePlayersAvx2(n, numPlayers, &current[lo], &clockwise[lo], &skip[lo], &active[lo]);
+        else
+#endif
+            advancePlayersScalar(n, numPlayers, &current[lo], &clockwise[lo], &skip[lo], &active[lo]);
 
-                // Keep asking until valid color is entered
-                do {
-                    cout << "Choose a color: "
-                         << RED_COLOR << "red "
-                         << BLUE_COLOR << "blue "
-                         << GREEN_COLOR << "green "
-                         << YELLOW_COLOR << "yellow"
-                         << RESET_COLOR << "\n";
+        return running;
+    }
 
-                    cin >> choice;
-                    playedCard.color = parseColor(choice);
+    // Plays every game to the end
+    void run() {
+        for (int lo = 0; lo < stride; lo += BATCH_BLOCK)
+            while (step(lo, min(lo + BATCH_BLOCK, stride)) > 0) {}
+        for (int g = 0; g < numGames; g++) {   // Write the final top card back
+            games[g].topCard.code = (unsigned char)((topColor[g] << 5) | topType[g]);
+            games[g].currentPlayer = current[g];
+            games[g].isClockwise = clockwise[g] != 0;
+        }
+    }
+};
 
-                    // Display error for invalid input
-                    if (playedCard.color == UNKNOWN_COLOR)
-                        cout << "\033[31mERROR: Invalid color. Please enter red, blue, green, or yellow.\033[0m\n";
+// --batch: plays the same games with the scalar engine and the batch
+// engine (scalar and AVX2 kernels), checks that they agree and compares speed
+int runBatchCheck(int numGames, int numPlayers, int cardsPerPlayer, unsigned long long seed) {
+    vector<unsigned long long> seeds(numGames);
+    for (int g = 0; g < numGames; g++) seeds[g] = seed + g;
 
-                } while (playedCard.color == UNKNOWN_COLOR);
+    // Scalar engine, one game after another
+    GameEngine<FirstPlayableBot> engine(numPlayers, cardsPerPlayer, seed);
+    vector<int> winners(numGames);
+    vector<GameState> finals(numGames);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int g = 0; g < numGames; g++) {
+        engine.module1.seedShuffle(seeds[g]);
+        winners[g] = engine.playGame();
+        finals[g] = engine.state;
+    }
+    double scalarSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "GameEngine:         " << numGames / scalarSeconds << " games/sec\n";
 
-                cout << "Color chosen: " << playedCard.getColorNameColored() << "\n";
-                break;
+    int bad = 0;
+    for (int mode = 0; mode < 2; mode++) {
+        BatchEngine batch(numPlayers, cardsPerPlayer, mode == 1);
+        if (mode == 1 && !batch.usesSimd()) {
+            cout << "BatchEngine (AVX2): not available on this CPU/compiler\n";
+            continue;
+        }
+        batch.deal(numGames, &seeds[0]);
+        start = chrono::steady_clock::now();
+        batch.run();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        int mismatches = 0;
+        for (int g = 0; g < numGames; g++) {
+            const GameState &a = finals[g], &b = batch.game(g);
+            bool same = winners[g] == batch.winnerOf(g) && a.drawPileSize() == b.drawPileSize() &&
+                        a.discardPile.size() == b.discardPile.size();
+            for (int p = 0; p < numPlayers && same; p++)
+                same = a.hands[p].hash == b.hands[p].hash && a.hands[p].count == b.hands[p].count;
+            mismatches += !same;
+        }
+        bad += mismatches;
+        cout << (mode ? "BatchEngine (AVX2): " : "BatchEngine scalar: ") << numGames / seconds
+             << " games/sec (dealing not timed), " << mismatches << " games differ\n";
+    }
+    return bad == 0 ? 0 : 1;
+}
+
+// --deck-check: deals many games with the shuffled and the lazy deck and
+// compares, for the start card and every draw after it, how often it is
+// a number, an action or a wild card (two-sample chi-square). The skipped
+// start cards make the end of the deck differ from a fresh shuffle, so
+// the draws after the start card matter as much as the start card.
+int runDeckCheck(int trials, int numPlayers, int cardsPerPlayer, unsigned long long seed) {
+    int positions = DECK_SIZE - numPlayers * cardsPerPlayer;   // Start card + draws
+    vector<long long> seen[2];
+    long long earlyActions[2] = {0, 0};
+
+    for (int lazy = 0; lazy < 2; lazy++) {
+        GameEngine<FirstPlayableBot> engine(numPlayers, cardsPerPlayer, seed);
+        GameConfig config = engine.module1.getConfig();
+        config.lazyDeck = lazy == 1;
+        engine.module1.setGameConfiguration(config);
+        seen[lazy].assign((size_t)positions * 3, 0);
+
+        for (int t = 0; t < trials; t++) {
+            engine.module1.seedShuffle(seed + (unsigned long long)t * 2 + lazy);
+            engine.module1.createDeck();
+            engine.module1.dealCards();
+            engine.module1.setTopCard();
+            GameState &s = engine.state;
+            for (int i = 0; i < positions; i++) {
+                Card c = i == 0 ? s.topCard : s.drawCard();
+                int cls = c.getType() == NUMBER ? 0 : (c.getColor() == WILD ? 2 : 1);
+                seen[lazy][i * 3 + cls]++;
+                if (i >= 1 && i <= 10) earlyActions[lazy] += cls != 0;
             }
+        }
+    }
 
-            // -------- WILD DRAW FOUR CARD --------
-            case WILD_DRAW_FOUR: {
-                int next = nextPlayer(currentPlayer, numPlayers);
+    double chi = 0, worst = 0;
+    int df = 0, worstAt = 0;
+    for (int i = 0; i < positions; i++) {
+        double here = 0;
+        int bins = 0;
+        for (int cls = 0; cls < 3; cls++) {
+            double a = (double)seen[0][i * 3 + cls], b = (double)seen[1][i * 3 + cls];
+            if (a + b == 0) continue;
+            here += (a - b) * (a - b) / (a + b);
+            bins++;
+        }
+        chi += here;
+        df += max(0, bins - 1);
+        if (here > worst) {
+            worst = here;
+            worstAt = i;
+        }
+    }
+    // Wilson-Hilferty: chi-square with df degrees of freedom as a normal z
+    double z = 0;
+    if (df > 0) {
+        double v = 2.0 / (9.0 * df);
+        z = (cbrt(chi / df) - (1 - v)) / sqrt(v);
+    }
 
-                cout << "Player " << next + 1 << " draws 4 cards!\n";
+    cout << "Non-number share of the 10 draws after the start card: shuffled "
+         << earlyActions[0] / (10.0 * trials) << ", lazy " << earlyActions[1] / (10.0 * trials) << "\n";
+    cout << "Start card + " << positions - 1 << " draws: chi-square " << chi << " (" << df
+         << " df, z = " << z << "), largest at " << (worstAt ? "draw " : "the start card")
+         << (worstAt ? to_string(worstAt) : string()) << " (" << worst << ")\n";
+    bool ok = z < 4;
+    if (!ok) cout << "The lazy deck does not deal like the shuffled deck\n";
+    return ok ? 0 : 1;
+}
 
-                // Next player draws four cards
-                for (int i = 0; i < 4; i++) {
-                    if (!deck.isDeckEmpty()) {
-                        playerHands[next][handSizes[next]++] = deck.drawCard();
-                    }
-                }
+// ======================================================
+//                     BENCHMARKS
+// ======================================================
+// Every heap allocation made while a benchmark runs is counted here, so
+// benchmarks can report allocations per operation / per game. All forms
+// of operator new are replaced: plain, array, and over-aligned (GameState
+// is alignas(64), so a vector<GameState> uses the aligned one). Other
+// modes only pay for the test of countAllocations.
+atomic<long long> allocationCount(0);
+atomic<bool> countAllocations(false);
 
-                // Keep asking until valid color is entered
-                string choice;
-                do {
-                    cout << "Choose a color: "
-                         << RED_COLOR << "red "
-                         << BLUE_COLOR << "blue "
-                         << GREEN_COLOR << "green "
-                         << YELLOW_COLOR << "yellow"
-                         << RESET_COLOR << "\n";
+void *countedNew(size_t n) {
+    if (countAllocations.load(memory_order_relaxed))
+        allocationCount.fetch_add(1, memory_order_relaxed);
+    void *p = malloc(n ? n : 1);
+    if (!p) throw bad_alloc();
+    return p;
+}
 
-                    cin >> choice;
-                    playedCard.color = parseColor(choice);
+void *countedAlignedNew(size_t n, align_val_t align) {
+    if (countAllocations.load(memory_order_relaxed))
+        allocationCount.fetch_add(1, memory_order_relaxed);
+    size_t a = (size_t)align;
+#ifdef _WIN32
+    void *p = _aligned_malloc(n ? n : 1, a);
+#else
+    void *p = aligned_alloc(a, n == 0 ? a : (n + a - 1) / a * a);   // Size must be a multiple of a
+#endif
+    if (!p) throw bad_alloc();
+    return p;
+}
 
-                    // Display error for invalid input
-                    if (playedCard.color == UNKNOWN_COLOR)
-                        cout << "\033[31mERROR: Invalid color. Please enter red, blue, green, or yellow.\033[0m\n";
+void alignedFree(void *p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
 
-                } while (playedCard.color == UNKNOWN_COLOR);
+void *operator new(size_t n) { return countedNew(n); }
+void *operator new[](size_t n) { return countedNew(n); }
+void *operator new(size_t n, align_val_t a) { return countedAlignedNew(n, a); }
+void *operator new[](size_t n, align_val_t a) { return countedAlignedNew(n, a); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+void operator delete(void *p, align_val_t) noexcept { alignedFree(p); }
+void operator delete[](void *p, align_val_t) noexcept { alignedFree(p); }
+void operator delete(void *p, size_t, align_val_t) noexcept { alignedFree(p); }
+void operator delete[](void *p, size_t, align_val_t) noexcept { alignedFree(p); }
 
-                cout << "Color chosen: " << playedCard.getColorNameColored() << "\n";
+// Results are written here so the compiler cannot drop the measured work
+volatile int benchSink = 0;
 
-                // Turn also moves to the next player
-                currentPlayer = next;
-                break;
-            }
-        }
+// A benchmark runs its operation 'iterations' times with two arguments
+// (number of players and cards per player where they matter)
+typedef void (*BenchFunction)(long long iterations, int players, int cards);
 
-        // Mark effect as applied so it does not repeat
-        effectApplied = true;
+struct Benchmark {
+    string name;
+    BenchFunction run;
+    int players;
+    int cards;
+    bool isGame;   // Report games/sec as well
+};
+
+// A quiet game with a created and shuffled deck. Benchmarks copy 'fresh'
+// back into 'state' to start over.
+struct BenchTable {
+    GameState state;
+    GameState fresh;
+    DeckManagement module1;
+    GameRules module3;
+
+    BenchTable(int players, int cards) : module1(state), module3(state) {
+        module1.setQuiet(true);
+        module3.setQuiet(true);
+        GameConfig config;
+        config.numPlayers = players;
+        config.cardsPerPlayer = cards;
+        module1.setGameConfiguration(config);
+        module1.seedShuffle(12345);
+        module1.createDeck();
+        fresh = state;
+    }
+};
+
+void benchCreateDeck(long long iterations, int players, int cards) {
+    BenchTable table(players, cards);
+    for (long long i = 0; i < iterations; i++) {
+        table.module1.createDeck();
+        benchSink += table.module1.isDeckEmpty();
+    }
+}
+
+// New shuffled deck, deal and first top card
+void benchShuffledDeal(long long iterations, int players, int cards) {
+    BenchTable table(players, cards);
+    for (long long i = 0; i < iterations; i++) {
+        table.module1.createDeck();
+        table.module1.dealCards();
+        table.module1.setTopCard();
+        benchSink += table.state.hands[0].size();
+    }
+}
+
+// Same with the count-based deck
+void benchLazyDeal(long long iterations, int players, int cards) {
+    BenchTable table(players, cards);
+    GameConfig config = table.module1.getConfig();
+    config.lazyDeck = true;
+    table.module1.setGameConfiguration(config);
+    for (long long i = 0; i < iterations; i++) {
+        table.module1.createDeck();
+        table.module1.dealCards();
+        table.module1.setTopCard();
+        benchSink += table.state.hands[0].size();
+    }
+}
+
+void benchShuffle(long long iterations, int, int) {
+    Card cards[DECK_SIZE];
+    for (int i = 0; i < DECK_SIZE; i++) cards[i].code = (unsigned char)i;
+    Rng rng(12345);
+    for (long long i = 0; i < iterations; i++) {
+        shuffleCards(cards, DECK_SIZE, rng);
+        benchSink += cards[0].code;
+    }
+}
+
+// Includes copying the fresh GameState back in (see cloneState)
+void benchDealCards(long long iterations, int players, int cards) {
+    BenchTable table(players, cards);
+    for (long long i = 0; i < iterations; i++) {
+        table.state = table.fresh;
+        table.module1.dealCards();
+        benchSink += table.state.hands[0].size();
+    }
+}
+
+void benchDrawCard(long long iterations, int players, int cards) {
+    BenchTable table(players, cards);
+    for (long long i = 0; i < iterations; i++) {
+        if (table.module1.isDeckEmpty()) table.state = table.fresh;
+        benchSink += table.module1.drawCard().code;
+    }
+}
+
+// Copying a whole game in flight
+void benchCloneState(long long iterations, int players, int cards) {
+    BenchTable table(players, cards);
+    table.module1.dealCards();
+    GameState copies[2];
+    for (long long i = 0; i < iterations; i++) {
+        copies[i & 1] = table.state;
+        table.state.currentPlayer = (int)i;
+        benchSink += copies[i & 1].currentPlayer;
+    }
+}
+
+// Random card pairs covering every card kind
+void fillRandomCards(Card cards[], int n, Rng &rng) {
+    for (int i = 0; i < n; i++) {
+        int color = (int)rng.below(5);
+        int typeValue = color == WILD ? 13 + (int)rng.below(2) : (int)rng.below(13);
+        cards[i].code = (unsigned char)((color << 5) | typeValue);
+    }
+}
+
+void benchIsValidMove(long long iterations, int, int) {
+    Card played[1024], top[1024];
+    Rng rng(12345);
+    fillRandomCards(played, 1024, rng);
+    fillRandomCards(top, 1024, rng);
+    PlayerManagement module2;
+    int valid = 0;
+    for (long long i = 0; i < iterations; i++)
+        valid += module2.isValidMove(played[i & 1023], top[(i >> 10) & 1023]);
+    benchSink += valid;
+}
+
+void benchLegalMoves(long long iterations, int, int cards) {
+    Hand hands[64];
+    Card tops[64];
+    Rng rng(12345);
+    for (int h = 0; h < 64; h++) {
+        Card c[10];
+        fillRandomCards(c, cards, rng);
+        for (int i = 0; i < cards; i++) hands[h].add(c[i]);
+    }
+    fillRandomCards(tops, 64, rng);
+    for (long long i = 0; i < iterations; i++)
+        benchSink += legalMoves(hands[i & 63], tops[(i >> 6) & 63]).count();
+}
+
+// Points, majority color and "can I play" on hands of 'cards' random
+// cards: with the per-kind bit counts (bits) or a loop over the cards (scan)
+struct HandQueryInput {
+    Hand hands[64];
+    Card tops[64];
+
+    explicit HandQueryInput(int cards) {
+        Rng rng(12345);
+        for (int h = 0; h < 64; h++) {
+            Card c[DECK_SIZE];
+            fillRandomCards(c, cards, rng);
+            for (int i = 0; i < cards; i++) hands[h].add(c[i]);
+        }
+        fillRandomCards(tops, 64, rng);
+        for (int h = 0; h < 64; h++)
+            if (tops[h].getTypeValue() >= WILD_CARD) tops[h].setColor(RED);
     }
 };
 
+void benchHandQueries(long long iterations, int, int cards) {
+    HandQueryInput input(cards);
+    int total = 0;
+    for (long long i = 0; i < iterations; i++) {
+        const HandBits &bits = input.hands[i & 63].bits;
+        total += bits.points() + bits.majorityColor() + bits.canPlayOn(input.tops[(i >> 6) & 63]);
+    }
+    benchSink += total;
+}
+
+void benchHandQueriesScan(long long iterations, int, int cards) {
+    HandQueryInput input(cards);
+    int total = 0;
+    for (long long i = 0; i < iterations; i++) {
+        const Hand &hand = input.hands[i & 63];
+        Card top = input.tops[(i >> 6) & 63];
+        int points = 0, counts[4] = {0, 0, 0, 0};
+        bool playable = false;
+        for (int j = 0; j < hand.size(); j++) {
+            points += hand[j].getValue();
+            if (hand[j].getColor() <= YELLOW) counts[hand[j].getColor()]++;
+            playable |= cardFits(hand[j], top);
+        }
+        int best = 0;
+        for (int c = 1; c < 4; c++)
+            if (counts[c] > counts[best]) best = c;
+        total += points + best + playable;
+    }
+    benchSink += total;
+}
+
+void benchApplySpecialCard(long long iterations, int players, int cards) {
+    BenchTable table(players, cards);
+    FirstPlayableBot bot;
+
+    // Only action and wild cards
+    Card specials[64];
+    Rng rng(12345);
+    for (int i = 0; i < 64; i++) {
+        int color = (int)rng.below(5);
+        int typeValue = color == WILD ? 13 + (int)rng.below(2) : 10 + (int)rng.below(3);
+        specials[i].code = (unsigned char)((color << 5) | typeValue);
+    }
+
+    int current = 0;
+    for (long long i = 0; i < iterations; i++) {
+        if ((i & 15) == 0) table.state = table.fresh;   // Empty hands, full deck
+        Card played = specials[i & 63];
+        table.module3.resetEffectFlag();
+        table.module3.applySpecialCard(played, current, players, table.state.hands,
+                                       table.module1, &bot);
+        current = table.module3.nextPlayer(current);
+    }
+    benchSink += current;
+}
+
+// One applyMove + undoMove pair, cycling through every move of a dealt position
+void benchApplyUndo(long long iterations, int players, int cards) {
+    GameEngine<FirstPlayableBot> engine(players, cards, 12345);
+    engine.module1.createDeck();
+    engine.module1.dealCards();
+    engine.module1.setTopCard();
+    engine.module3.reset();
+
+    GameState &state = engine.state;
+    Move moves[MAX_MOVES];
+    int n = generateMoves(state, moves);
+    MoveUndo undo;
+
+    int winners = 0;
+    for (long long i = 0; i < iterations; i++) {
+        winners += applyMove(state, moves[i % n], undo);
+        undoMove(state, undo);
+    }
+    benchSink += winners + state.currentPlayer;
+}
+
+// applyMove + hashState + undoMove, the per-node cost a search pays for hashing
+void benchHashState(long long iterations, int players, int cards) {
+    GameEngine<FirstPlayableBot> engine(players, cards, 12345);
+    engine.module1.createDeck();
+    engine.module1.dealCards();
+    engine.module1.setTopCard();
+    engine.module3.reset();
+
+    GameState &state = engine.state;
+    Move moves[MAX_MOVES];
+    int n = generateMoves(state, moves);
+    MoveUndo undo;
+
+    unsigned long long total = 0;
+    for (long long i = 0; i < iterations; i++) {
+        applyMove(state, moves[i % n], undo);
+        total += hashState(state);
+        undoMove(state, undo);
+    }
+    benchSink += (int)total;
+}
+
+// One store and one probe on a 1M-entry table with random keys
+void benchTranspositionTable(long long iterations, int, int) {
+    static TranspositionTable table(20);
+    Rng rng(12345);
+    TTData data = {};
+    int hits = 0;
+    for (long long i = 0; i < iterations; i++) {
+        unsigned long long key = rng.next();
+        data.visits = (unsigned short)i;
+        table.store(key, data);
+        hits += table.probe(key, data);
+    }
+    benchSink += hits;
+}
+
+// ISMCTS playouts from a dealt position on one thread (ns/op = ns per playout)
+void benchIsmctsPlayout(long long iterations, int players, int cards) {
+    GameEngine<FirstPlayableBot> engine(players, cards, 12345);
+    engine.module1.createDeck();
+    engine.module1.dealCards();
+    engine.module1.setTopCard();
+    engine.module3.reset();
+
+    static IsmctsTree tree;
+    tree.init(MAX_TREE_NODES, 12345);
+    tree.search(engine.state, (int)iterations);
+    benchSink += tree.rootVisits(DRAW_MOVE_KEY);
+}
+
+// One env step (agent plays its first legal action) in a batch of 1024
+void benchEnvStep(long long iterations, int players, int cards) {
+    const int N = 1024;
+    static VecEnv<FirstPlayableBot> env(players, cards);
+    static unsigned long long seeds[N];
+    static int actions[N];
+    for (int i = 0; i < N; i++) seeds[i] = 12345 + i;
+    env.reset(N, seeds);
+
+    for (long long done = 0; done < iterations; done += N) {
+        for (int i = 0; i < N; i++) {
+            const signed char *mask = env.actionMasks() + (size_t)i * NUM_ACTIONS;
+            int a = 0;
+            while (!mask[a]) a++;
+            actions[i] = a;
+        }
+        env.step((int)min<long long>(N, iterations - done), actions);
+    }
+    benchSink += (int)env.rewards()[0];
+}
+
+void benchFullGame(long long iterations, int players, int cards) {
+    GameEngine<FirstPlayableBot> engine(players, cards, 12345);
+    int winners = 0;
+    for (long long i = 0; i < iterations; i++)
+        winners += engine.playGame();
+    benchSink += winners;
+}
+
+// Same games with the count-based deck
+void benchFullGameLazy(long long iterations, int players, int cards) {
+    bool old = lazyDeckMode;
+    lazyDeckMode = true;
+    GameEngine<FirstPlayableBot> engine(players, cards, 12345);
+    lazyDeckMode = old;
+    int winners = 0;
+    for (long long i = 0; i < iterations; i++)
+        winners += engine.playGame();
+    benchSink += winners;
+}
+
+// Same games under a set of house rules. The standard set must take as
+// long as fullGame: rules that are off cost nothing.
+template <class Rules>
+void benchFullGameRules(long long iterations, int players, int cards) {
+    GameEngine<FirstPlayableBot, Rules> engine(players, cards, 12345);
+    int winners = 0;
+    for (long long i = 0; i < iterations; i++)
+        winners += engine.playGame();
+    benchSink += winners;
+}
+
+// One round of a match to 500 (a new match starts when one is over),
+// to compare with fullGame/4/7 and to show rounds allocate nothing
+void benchMatchRound(long long iterations, int players, int cards) {
+    GameEngine<FirstPlayableBot> engine(players, cards, 12345);
+    RngStreams streams(12345);
+    MatchResult result = {};
+    unsigned long long match = 0;
+    int round = 0, winners = 0;
+    for (long long i = 0; i < iterations; i++) {
+        int winner = playMatchRound(engine, streams, match, round++, result);
+        winners += winner;
+        if (winner >= 0 && result.score[winner] >= MATCH_TARGET) {
+            result = MatchResult();
+            match++;
+            round = 0;
+        }
+    }
+    benchSink += winners;
+}
+
+// Same games with the event log on (not opened, so no file I/O is timed)
+void benchFullGameLogged(long long iterations, int players, int cards) {
+    static EventLog log;
+    GameEngine<FirstPlayableBot> engine(players, cards, 12345);
+    engine.setEventLog(&log);
+    int winners = 0;
+    for (long long i = 0; i < iterations; i++)
+        winners += engine.playGame();
+    benchSink += winners;
+}
+
+vector<Benchmark> registerBenchmarks() {
+    vector<Benchmark> list;
+    list.push_back(Benchmark{"createDeck", benchCreateDeck, 4, 7, false});
+    list.push_back(Benchmark{"shuffle", benchShuffle, 4, 7, false});
+    list.push_back(Benchmark{"shuffledDeal/4/7", benchShuffledDeal, 4, 7, false});
+    list.push_back(Benchmark{"lazyDeal/4/7", benchLazyDeal, 4, 7, false});
+    list.push_back(Benchmark{"drawCard", benchDrawCard, 4, 7, false});
+    list.push_back(Benchmark{"cloneState", benchCloneState, 4, 7, false});
+    list.push_back(Benchmark{"applyUndo", benchApplyUndo, 4, 7, false});
+    list.push_back(Benchmark{"hashState", benchHashState, 4, 7, false});
+    list.push_back(Benchmark{"transpositionTable", benchTranspositionTable, 4, 7, false});
+    list.push_back(Benchmark{"envStep", benchEnvStep, 4, 7, false});
+    for (int players = 2; players <= 6; players += 2)
+        list.push_back(Benchmark{"ismctsPlayout/" + to_string(players), benchIsmctsPlayout,
+                                 players, 7, false});
+    list.push_back(Benchmark{"isValidMove", benchIsValidMove, 4, 7, false});
+    for (int cards = 5; cards <= 10; cards++)
+        list.push_back(Benchmark{"legalMoves/" + to_string(cards), benchLegalMoves, 4, cards, false});
+    for (int cards = 1; cards <= 25; cards *= 5) {
+        list.push_back(Benchmark{"handQueries/" + to_string(cards), benchHandQueries, 4, cards, false});
+        list.push_back(Benchmark{"handQueriesScan/" + to_string(cards), benchHandQueriesScan,
+                                 4, cards, false});
+    }
+    for (int players = 2; players <= 6; players++)
+        list.push_back(Benchmark{"applySpecialCard/" + to_string(players),
+                                 benchApplySpecialCard, players, 7, false});
+    for (int players = 2; players <= 6; players++)
+        for (int cards = 5; cards <= 10; cards++)
+            list.push_back(Benchmark{"dealCards/" + to_string(players) + "/" + to_string(cards),
+                                     benchDealCards, players, cards, false});
+    for (int players = 2; players <= 6; players++)
+        for (int cards = 5; cards <= 10; cards++)
+            list.push_back(Benchmark{"fullGame/" + to_string(players) + "/" + to_string(cards),
+                                     benchFullGame, players, cards, true});
+    list.push_back(Benchmark{"fullGameLogged/4/7", benchFullGameLogged, 4, 7, true});
+    list.push_back(Benchmark{"matchRound/4/7", benchMatchRound, 4, 7, true});
+    list.push_back(Benchmark{string("fullGameRules/") + StandardRules::name,
+                             benchFullGameRules<StandardRules>, 4, 7, true});
+    list.push_back(Benchmark{string("fullGameRules/") + StackingRules::name,
+                             benchFullGameRules<StackingRules>, 4, 7, true});
+    list.push_back(Benchmark{string("fullGameRules/") + SevenZeroRules::name,
+                             benchFullGameRules<SevenZeroRules>, 4, 7, true});
+    list.push_back(Benchmark{string("fullGameRules/") + JumpInRules::name,
+                             benchFullGameRules<JumpInRules>, 4, 7, true});
+    list.push_back(Benchmark{string("fullGameRules/") + DrawUntilPlayableRules::name,
+                             benchFullGameRules<DrawUntilPlayableRules>, 4, 7, true});
+    list.push_back(Benchmark{string("fullGameRules/") + HouseRules::name,
+                             benchFullGameRules<HouseRules>, 4, 7, true});
+    for (int players = 2; players <= 6; players += 2)
+        list.push_back(Benchmark{"fullGameLazy/" + to_string(players) + "/7", benchFullGameLazy,
+                                 players, 7, true});
+    return list;
+}
+
+// Runs every benchmark whose name contains 'filter'. Like Google Benchmark,
+// the iteration count grows until one run takes at least minSeconds.
+void runBenchmarks(const string &filter, double minSeconds) {
+    vector<Benchmark> list = registerBenchmarks();
+
+    cout << left << setw(26) << "Benchmark" << right << setw(14) << "ns/op"
+         << setw(14) << "iterations" << setw(14) << "allocs/op" << setw(14) << "games/s" << "\n";
+    cout << string(82, '-') << "\n";
+
+    for (size_t b = 0; b < list.size(); b++) {
+        const Benchmark &bm = list[b];
+        if (bm.name.find(filter) == string::npos) continue;
+
+        long long iterations = 1;
+        double seconds = 0;
+        long long allocations = 0;
+        while (true) {
+            long long allocBefore = allocationCount.load();
+            countAllocations = true;
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            bm.run(iterations, bm.players, bm.cards);
+            seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            countAllocations = false;
+            allocations = allocationCount.load() - allocBefore;
+            if (seconds >= minSeconds || iterations >= (1LL << 40)) break;
+
+            // Aim a bit past the target time, at most 10x more per step
+            double factor = seconds > 0 ? minSeconds * 1.4 / seconds : 10;
+            if (factor > 10) factor = 10;
+            if (factor < 2) factor = 2;
+            iterations = (long long)(iterations * factor);
+        }
+
+        cout << left << setw(26) << bm.name << right << fixed << setprecision(1)
+             << setw(14) << seconds * 1e9 / iterations
+             << setw(14) << iterations
+             << setprecision(3) << setw(14) << (double)allocations / iterations;
+        if (bm.isGame) cout << setprecision(0) << setw(14) << iterations / seconds;
+        cout << "\n";
+    }
+}
+
 // ======================================================
-//                      MAIN PROGRAM
+//                    INTERACTIVE GAME
 // ======================================================
-int main() {
-    DeckManagement module1;
+// Everyone is a human player at the console, under house rules 'Rules'
+template <class Rules>
+int playHumanGame(EventLog *events) {
+    GameState state;   // Deck, hands, top card, turn and direction
+    DeckManagement module1(state);
     PlayerManagement module2;
-    GameRules module3;
+    GameRulesT<Rules> module3(state);
 
-    Card playerHands[6][50];  // 6 players max, 50 cards max per player
-    int handSizes[6] = {0};
+    if (events) {
+        module1.setEventLog(events);
+        module2.setEventLog(events);
+        module3.setEventLog(events);
+    }
 
     // Initial setup
     module1.displayWelcomeMessage();
+    if (!is_same<Rules, StandardRules>::value) cout << "House rules: " << Rules::name << "\n\n";
     module1.inputGameConfiguration();
     module1.createDeck();
-    GameConfig config = module1.getConfig();
-    module1.dealCards(playerHands, handSizes);
+    module1.dealCards();
     module1.setTopCard();
 
-    Card topCard = module1.getInitialTopCard();
     cout << "\033[95m---------- GAME START ----------\033[0m\n";
 
-    int currentPlayer = 0;
-    bool gameOver = false;
+    PlayerPolicy *policies[MAX_PLAYERS];
+    for (int i = 0; i < MAX_PLAYERS; i++) policies[i] = NULL;
+    return runGame(module1, module2, module3, policies, false);
+}
 
-    // Main game loop
-    while (!module1.isDeckEmpty() && !gameOver) {
-        cout << "\n--- " << config.playerNames[currentPlayer] << "'s TURN ---\n";
+// ======================================================
+//                      MAIN PROGRAM
+// ======================================================
+int main(int argc, char *argv[]) {
+    // "--log <file>" can be given with any mode: every game is recorded
+    string logPath;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (string(argv[i]) != "--log") continue;
+        logPath = argv[i + 1];
+        for (int j = i; j + 2 < argc; j++) argv[j] = argv[j + 2];
+        argc -= 2;
+        break;
+    }
+    // "--rules <name>" picks the house rules of --sim, --match, --farm and
+    // the interactive game; the other modes play the standard rules
+    string rulesName = StandardRules::name;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (string(argv[i]) != "--rules") continue;
+        rulesName = argv[i + 1];
+        for (int j = i; j + 2 < argc; j++) argv[j] = argv[j + 2];
+        argc -= 2;
+        break;
+    }
+    if (!withRules(rulesName, [](auto) {})) {
+        cout << "Unknown rules '" << rulesName
+             << "' (standard|stacking|sevenZero|jumpIn|drawUntil|plainReverse|house)\n";
+        return 1;
+    }
+    if (rulesName != StandardRules::name) {
+        const char *standardOnly[] = {"--replay", "--corpus", "--env", "--batch", "--search",
+                                      "--deck-check", "--bench", "--tournament"};
+        for (size_t m = 0; m < sizeof(standardOnly) / sizeof(standardOnly[0]); m++)
+            if (argc > 1 && string(argv[1]) == standardOnly[m])
+                cout << "Note: --rules is not supported with " << standardOnly[m]
+                     << ", the standard rules are played\n";
+        if (!logPath.empty()) {   // Replays play the standard rules
+            cout << "Note: --log only records games under the standard rules, nothing is logged\n";
+            logPath.clear();
+        }
+    }
+    // "--lazy-deck" can be given with any bot-only mode (count-based deck)
+    for (int i = 1; i < argc; i++) {
+        if (string(argv[i]) != "--lazy-deck") continue;
+        lazyDeckMode = true;
+        for (int j = i; j + 1 < argc; j++) argv[j] = argv[j + 1];
+        argc--;
+        break;
+    }
+    EventLog eventLog;
+    EventLog *events = NULL;
 
-        bool playedThisTurn = false;
-        bool won = module2.playerTurn(
-            config.playerNames[currentPlayer],
-            playerHands[currentPlayer],
-            handSizes[currentPlayer],
-            topCard,
-            module1,
-            playedThisTurn
-        );
+    // Headless mode: <program> --sim [games] [players] [cardsPerPlayer] [seed] [bot]
+    //                                 [playouts] [search threads]   (the last two for ismcts)
+    if (argc > 1 && string(argv[1]) == "--sim") {
+        long long games = argc > 2 ? atoll(argv[2]) : 100000;
+        int players     = argc > 3 ? atoi(argv[3]) : 4;
+        int cards       = argc > 4 ? atoi(argv[4]) : 7;
+        unsigned long long seed = argc > 5 ? strtoull(argv[5], NULL, 10)
+                                           : (unsigned long long)time(0);
+        string bot      = argc > 6 ? argv[6] : "mixed";
+        ismctsConfig.playouts = argc > 7 ? atoi(argv[7]) : 1000;
+        ismctsConfig.threads  = argc > 8 ? atoi(argv[8]) : (int)thread::hardware_concurrency();
+        bool ok = games >= 1 && players >= 2 && players <= MAX_PLAYERS && cards >= 5 && cards <= 10 &&
+                  ismctsConfig.playouts >= 1;
+        if (ok && !logPath.empty()) {
+            if (!eventLog.open(logPath, seed)) {
+                cout << "Cannot write " << logPath << "\n";
+                return 1;
+            }
+            events = &eventLog;
+        }
+        if (!ok || !withBotType(bot, [&](auto botType) {
+                withRules(rulesName, [&](auto rulesType) {
+                    runSimulation<decltype(botType), decltype(rulesType)>(games, players, cards,
+                                                                          seed, events);
+                });
+            })) {
+            cout << "Usage: " << argv[0] << " --sim [games] [players 2-10] [cards 5-10] [seed]"
+                 << " [first|random|greedy|color|mixed|ismcts|count] [playouts] [search threads]\n";
+            return 1;
+        }
+        return 0;
+    }
 
-        if (playedThisTurn) {
-            module3.resetEffectFlag();  // allow special card effect
+    // Match mode: <program> --match [matches] [players] [cardsPerPlayer] [seed] [bot] [target]
+    if (argc > 1 && string(argv[1]) == "--match") {
+        long long matches = argc > 2 ? atoll(argv[2]) : 10000;
+        int players       = argc > 3 ? atoi(argv[3]) : 4;
+        int cards         = argc > 4 ? atoi(argv[4]) : 7;
+        unsigned long long seed = argc > 5 ? strtoull(argv[5], NULL, 10)
+                                           : (unsigned long long)time(0);
+        string bot        = argc > 6 ? argv[6] : "mixed";
+        int target        = argc > 7 ? atoi(argv[7]) : MATCH_TARGET;
+        bool ok = matches >= 1 && players >= 2 && players <= MAX_PLAYERS && cards >= 5 &&
+                  cards <= 10 && target >= 1;
+        if (!logPath.empty()) cout << "Note: --log is not supported with --match, nothing is logged\n";
+        if (!ok || !withBotType(bot, [&](auto botType) {
+                withRules(rulesName, [&](auto rulesType) {
+                    runMatches<decltype(botType), decltype(rulesType)>(matches, players, cards,
+                                                                       seed, target);
+                });
+            })) {
+            cout << "Usage: " << argv[0] << " --match [matches] [players 2-10] [cards 5-10] [seed]"
+                 << " [first|random|greedy|color|mixed|ismcts|count] [target points]\n";
+            return 1;
         }
+        return 0;
+    }
 
-        if (won) {
-            gameOver = true;
-            break;
+    // Replay mode: <program> --replay <log file> [game] [turn]
+    // Without a game, checks every game in the log against the rules.
+    if (argc > 2 && string(argv[1]) == "--replay") {
+        int game = argc > 3 ? atoi(argv[3]) : -1;
+        int turn = argc > 4 ? atoi(argv[4]) : -1;
+        return runReplay(argv[2], game, turn);
+    }
+
+    // Corpus mode: <program> --corpus build <file> [games] [players] [cards] [seed] [bot]
+    //              <program> --corpus query <file> <plus4-turn1|wilds|actions|summary|replay> [threads]
+    if (argc > 3 && string(argv[1]) == "--corpus") {
+        string what = argv[2], path = argv[3];
+        if (what == "build") {
+            long long games = argc > 4 ? atoll(argv[4]) : 1000000;
+            int players     = argc > 5 ? atoi(argv[5]) : 4;
+            int cards       = argc > 6 ? atoi(argv[6]) : 7;
+            unsigned long long seed = argc > 7 ? strtoull(argv[7], NULL, 10)
+                                               : (unsigned long long)time(0);
+            string bot      = argc > 8 ? argv[8] : "mixed";
+            ismctsConfig.threads = 1;
+            bool ok = games >= 1 && players >= 2 && players <= MAX_PLAYERS && cards >= 5 && cards <= 10;
+            bool built = false;
+            if (ok && withBotType(bot, [&](auto botType) {
+                    built = buildCorpus<decltype(botType)>(path, games, players, cards, seed);
+                })) return built ? 0 : 1;
+        } else if (what == "query" && argc > 4) {
+            int threads = argc > 5 ? atoi(argv[5]) : (int)thread::hardware_concurrency();
+            return runCorpusQuery(path, argv[4], threads);
         }
+        cout << "Usage: " << argv[0] << " --corpus build <file> [games] [players 2-10] [cards 5-10]"
+             << " [seed] [bot]\n       " << argv[0]
+             << " --corpus query <file> <plus4-turn1|wilds|actions|summary|replay> [threads]\n";
+        return 1;
+    }
 
-        // Apply special card effects
-        module3.applySpecialCard(
-            topCard,
-            currentPlayer,
-            config.numPlayers,
-            playerHands,
-            handSizes,
-            module1
-        );
+    // RL environment demo: <program> --env [envs] [steps] [players] [cards] [seed]
+    if (argc > 1 && string(argv[1]) == "--env") {
+        int envs    = argc > 2 ? atoi(argv[2]) : 10000;
+        int steps   = argc > 3 ? atoi(argv[3]) : 100;
+        int players = argc > 4 ? atoi(argv[4]) : 4;
+        int cards   = argc > 5 ? atoi(argv[5]) : 7;
+        unsigned long long seed = argc > 6 ? strtoull(argv[6], NULL, 10)
+                                           : (unsigned long long)time(0);
+        if (envs < 1 || steps < 1 || players < 2 || players > MAX_PLAYERS || cards < 5 || cards > 10) {
+            cout << "Usage: " << argv[0] << " --env [envs] [steps] [players 2-10] [cards 5-10] [seed]\n";
+            return 1;
+        }
+        runEnvDemo(envs, steps, players, cards, seed);
+        return 0;
+    }
 
-        // Move to next player
-        currentPlayer = module3.nextPlayer(currentPlayer, config.numPlayers);
+    // Batch engine check: <program> --batch [games] [players] [cards] [seed]
+    if (argc > 1 && string(argv[1]) == "--batch") {
+        int games   = argc > 2 ? atoi(argv[2]) : 100000;
+        int players = argc > 3 ? atoi(argv[3]) : 4;
+        int cards   = argc > 4 ? atoi(argv[4]) : 7;
+        unsigned long long seed = argc > 5 ? strtoull(argv[5], NULL, 10)
+                                           : (unsigned long long)time(0);
+        if (games < 1 || players < 2 || players > MAX_PLAYERS || cards < 5 || cards > 10) {
+            cout << "Usage: " << argv[0] << " --batch [games] [players 2-10] [cards 5-10] [seed]\n";
+            return 1;
+        }
+        return runBatchCheck(games, players, cards, seed);
+    }
+
+    // Search check: <program> --search [players] [cards] [seed] [playouts] [search threads]
+    if (argc > 1 && string(argv[1]) == "--search") {
+        int players = argc > 2 ? atoi(argv[2]) : 4;
+        int cards   = argc > 3 ? atoi(argv[3]) : 7;
+        unsigned long long seed = argc > 4 ? strtoull(argv[4], NULL, 10)
+                                           : (unsigned long long)time(0);
+        ismctsConfig.playouts = argc > 5 ? atoi(argv[5]) : 100000;
+        ismctsConfig.threads  = argc > 6 ? atoi(argv[6]) : 4;
+        if (players < 2 || players > MAX_PLAYERS || cards < 5 || cards > 10 ||
+            ismctsConfig.playouts < 1 || ismctsConfig.threads < 1) {
+            cout << "Usage: " << argv[0] << " --search [players 2-10] [cards 5-10] [seed]"
+                 << " [playouts] [search threads]\n";
+            return 1;
+        }
+        return runSearchCheck(players, cards, seed);
+    }
+
+    // Lazy deck check: <program> --deck-check [trials] [players] [cards] [seed]
+    if (argc > 1 && string(argv[1]) == "--deck-check") {
+        int trials  = argc > 2 ? atoi(argv[2]) : 200000;
+        int players = argc > 3 ? atoi(argv[3]) : 4;
+        int cards   = argc > 4 ? atoi(argv[4]) : 7;
+        unsigned long long seed = argc > 5 ? strtoull(argv[5], NULL, 10)
+                                           : (unsigned long long)time(0);
+        if (trials < 1 || players < 2 || players > MAX_PLAYERS || cards < 5 || cards > 10) {
+            cout << "Usage: " << argv[0] << " --deck-check [trials] [players 2-10] [cards 5-10] [seed]\n";
+            return 1;
+        }
+        return runDeckCheck(trials, players, cards, seed);
     }
 
-    if (!gameOver)
+    // Benchmark mode: <program> --bench [name filter] [min seconds per benchmark]
+    if (argc > 1 && string(argv[1]) == "--bench") {
+        string filter = argc > 2 ? argv[2] : "";
+        double minSeconds = argc > 3 ? atof(argv[3]) : 0.2;
+        runBenchmarks(filter, minSeconds);
+        return 0;
+    }
+
+    // Multi-threaded mode: <program> --farm [games] [players] [cardsPerPlayer] [threads] [seed] [bot]
+    //                                        [playouts]   (ismcts searches on one thread per game)
+    if (argc > 1 && string(argv[1]) == "--farm") {
+        long long games = argc > 2 ? atoll(argv[2]) : 1000000;
+        int players     = argc > 3 ? atoi(argv[3]) : 4;
+        int cards       = argc > 4 ? atoi(argv[4]) : 7;
+        int threads     = argc > 5 ? atoi(argv[5]) : (int)thread::hardware_concurrency();
+        unsigned long long seed = argc > 6 ? strtoull(argv[6], NULL, 10)
+                                           : (unsigned long long)time(0);
+        string bot      = argc > 7 ? argv[7] : "mixed";
+        ismctsConfig.playouts = argc > 8 ? atoi(argv[8]) : 1000;
+        ismctsConfig.threads  = 1;
+        if (threads < 1) threads = 1;
+        bool ok = games >= 1 && games <= 4000000000LL && players >= 2 && players <= MAX_PLAYERS &&
+                  cards >= 5 && cards <= 10 && ismctsConfig.playouts >= 1;
+        if (!logPath.empty()) cout << "Note: --log is not supported with --farm, nothing is logged\n";
+        if (!ok || !withBotType(bot, [&](auto botType) {
+                withRules(rulesName, [&](auto rulesType) {
+                    runFarm<decltype(botType), decltype(rulesType)>(games, players, cards,
+                                                                    threads, seed);
+                });
+            })) {
+            cout << "Usage: " << argv[0]
+                 << " --farm [games] [players 2-10] [cards 5-10] [threads] [seed]"
+                 << " [first|random|greedy|color|mixed|ismcts|count] [playouts]\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    // Tournament: <program> --tournament [bots] [max games per pairing]
+    //                          [players] [cards] [threads] [seed] [elo bound]
+    if (argc > 1 && string(argv[1]) == "--tournament") {
+        string list       = argc > 2 ? argv[2] : "first,random,greedy,color";
+        long long games   = argc > 3 ? atoll(argv[3]) : 200000;
+        int players       = argc > 4 ? atoi(argv[4]) : 2;
+        int cards         = argc > 5 ? atoi(argv[5]) : 7;
+        int threads       = argc > 6 ? atoi(argv[6]) : (int)thread::hardware_concurrency();
+        unsigned long long seed = argc > 7 ? strtoull(argv[7], NULL, 10)
+                                           : (unsigned long long)time(0);
+        double eloBound   = argc > 8 ? atof(argv[8]) : 10;
+        if (threads < 1) threads = 1;
+
+        // Comma separated bot names
+        vector<BotKind> kinds;
+        bool ok = true;
+        stringstream ss(list);
+        string name;
+        while (getline(ss, name, ',')) {
+            int k = 0;
+            for (; k < NUM_BOT_KINDS; k++) {
+                BotByKind bot;
+                bot.setKind((BotKind)k);
+                if (name == bot.botName()) break;
+            }
+            if (k == NUM_BOT_KINDS) ok = false;
+            else kinds.push_back((BotKind)k);
+        }
+        ok = ok && kinds.size() >= 2 && games >= 2 && games <= 4000000000LL && players >= 2 &&
+             players <= MAX_PLAYERS && players % 2 == 0 && cards >= 5 && cards <= 10 &&
+             eloBound > 0;
+        if (!ok) {
+            cout << "Usage: " << argv[0] << " --tournament [bots, e.g. first,random,greedy,color]"
+                 << " [max games per pairing] [players 2-10, even] [cards 5-10] [threads] [seed]"
+                 << " [elo bound]\n";
+            return 1;
+        }
+        runTournament(kinds, games, players, cards, threads, seed, eloBound);
+        return 0;
+    }
+
+    if (!logPath.empty()) {
+        if (!eventLog.open(logPath, (unsigned long long)time(0))) {
+            cout << "Cannot write " << logPath << "\n";
+            return 1;
+        }
+        events = &eventLog;
+    }
+
+    // Everyone is a human player
+    int winner = -1;
+    withRules(rulesName, [&](auto rulesType) { winner = playHumanGame<decltype(rulesType)>(events); });
+
+    if (winner < 0)
         cout << "\033[95m\nDeck ended  game results in a draw.\033[0m\n";
 
     return 0;
 }
-